@@ -123,6 +123,20 @@ define concat_cmd
 $(call split_args,$(1),build_cmd)
 endef
 
+# Copy an image to $(BIN_DIR). With the JSON image info enabled, the data
+# written to the destination is hashed on its way through and the sha256
+# stored next to the JSON info file, so that json_add_image_info.py does not
+# have to read the image again.
+# 1: source, 2: destination, 3: optional filter command, e.g. gzip
+image_install = \
+	$(if $(CONFIG_JSON_OVERVIEW_IMAGE_INFO), \
+		mkdir -p $(BUILD_DIR)/json_info_files && \
+		( set -o pipefail; \
+			$(if $(3),$(3) < $(1),cat $(1)) | tee $(2) | \
+				$(MKHASH) sha256 > $(BUILD_DIR)/json_info_files/$(notdir $(1)).sha256 ) || { \
+			rm -f $(2) $(BUILD_DIR)/json_info_files/$(notdir $(1)).sha256; false; }, \
+		$(if $(3),$(3) < $(1) > $(2),cp $(1) $(2)))
+
 # pad to 4k, 8k, 16k, 64k, 128k, 256k and add jffs2 end-of-filesystem mark
 define prepare_generic_squashfs
 	$(STAGING_DIR_HOST)/bin/padjffs2 $(1) 4 8 16 64 128 256
@@ -488,7 +502,7 @@ define Device/Build/initramfs
   $(KDIR)/$$(KERNEL_INITRAMFS_NAME):: image_prepare
   $(1)-images: $$(if $$(KERNEL_INITRAMFS),$(BIN_DIR)/$$(KERNEL_INITRAMFS_IMAGE))
   $(BIN_DIR)/$$(KERNEL_INITRAMFS_IMAGE): $(KDIR)/tmp/$$(KERNEL_INITRAMFS_IMAGE)
-	cp $$^ $$@
+	$$(call image_install,$$^,$$@)
 
   $(KDIR)/tmp/$$(KERNEL_INITRAMFS_IMAGE): $(KDIR)/$$(KERNEL_INITRAMFS_NAME) $(CURDIR)/Makefile $$(KERNEL_DEPENDS) image_prepare
 	@rm -f $$@
@@ -605,10 +619,10 @@ define Device/Build/image
   .IGNORE: $(BIN_DIR)/$(call DEVICE_IMG_NAME,$(1),$(2))
 
   $(BIN_DIR)/$(call DEVICE_IMG_NAME,$(1),$(2)).gz: $(KDIR)/tmp/$(call DEVICE_IMG_NAME,$(1),$(2))
-	gzip -c -9n $$^ > $$@
+	$$(call image_install,$$^,$$@,gzip -c -9n)
 
   $(BIN_DIR)/$(call DEVICE_IMG_NAME,$(1),$(2)): $(KDIR)/tmp/$(call DEVICE_IMG_NAME,$(1),$(2))
-	cp $$^ $$@
+	$$(call image_install,$$^,$$@)
 
   $(BUILD_DIR)/json_info_files/$(call DEVICE_IMG_NAME,$(1),$(2)).json: $(BIN_DIR)/$(call DEVICE_IMG_NAME,$(1),$(2))$$(GZ_SUFFIX)
 	@mkdir -p $$(shell dirname $$@)
@@ -660,7 +674,7 @@ define Device/Build/artifact
   .IGNORE: $(BIN_DIR)/$(DEVICE_IMG_PREFIX)-$(1)
 
   $(BIN_DIR)/$(DEVICE_IMG_PREFIX)-$(1): $(KDIR)/tmp/$(DEVICE_IMG_PREFIX)-$(1)
-	cp $$^ $$@
+	$$(call image_install,$$^,$$@)
 
   $(BUILD_DIR)/json_info_files/$(DEVICE_IMG_PREFIX)-$(1).json: $(BIN_DIR)/$(DEVICE_IMG_PREFIX)-$(1)
 	@mkdir -p $$(shell dirname $$@)
@@ -154,6 +154,8 @@ endef
 
 define KernelPackage/hooks
   ifneq ($(PKG_NAME),kernel)
+    # The collected symbols are picked up by other module builds
+    PKG_CACHE:=0
     Hooks/Compile/Post += collect_module_symvers
   endif
   define KernelPackage/hooks
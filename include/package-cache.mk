@@ -0,0 +1,163 @@
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Copyright (C) 2026 OpenWrt.org
+
+# Shared package artifact cache
+#
+# With CONFIG_PKG_CACHE enabled, the result of a package build (its .ipk
+# files, the .pkgdir trees that go into the root staging dir and the
+# Build/InstallDev output) is stored in $(PKG_CACHE_DIR) under a key that
+# covers everything feeding into the build:
+#
+#  - the package directory and $(PKG_FILE_DEPENDS)
+#  - the source hashes, version and source date epoch
+#  - the cache keys of the packages it depends on at build or run time
+#  - the package directories of its host build dependencies, recursively
+#  - the toolchain, target flags and kernel vermagic
+#  - the build infrastructure (include/, rules.mk, toolchain/, tools/) and
+#    the value of every config symbol rules.mk and include/*.mk refer to
+#  - $(PKG_PREPARED_DEPENDS), $(PKG_CONFIG_DEPENDS) and the package selection
+#
+# A later build arriving at the same key, in this or any other build tree
+# sharing the cache directory, skips prepare, configure and compile and
+# restores the artifacts instead.
+#
+# Every build records its key in $(PKG_INFO_DIR)/<package>.cachekey, or "-"
+# when it was not cached, so that packages built on top of an uncached
+# dependency are not cached either. Packages that pick up inputs not listed
+# above, e.g. tools from the build host, or that leave files outside their
+# own package and staging dir for others to use, e.g. in $(STAGING_DIR_IMAGE)
+# or $(KERNEL_BUILD_DIR), should set PKG_CACHE:=0.
+
+PKG_CACHE ?= 1
+PKG_CACHE_DIR:=$(if $(call qstrip,$(CONFIG_PKG_CACHE_DIR)),$(call qstrip,$(CONFIG_PKG_CACHE_DIR)),$(TOPDIR)/.pkgcache)
+PKG_CACHE_WORKDIR=$(PKG_BUILD_DIR)/ipkg-cache
+PKG_CACHE_INFRA:=$(INCLUDE_DIR) $(TOPDIR)/rules.mk $(TOPDIR)/toolchain $(TOPDIR)/tools $(SCRIPT_DIR)/ipkg-build $(SCRIPT_DIR)/rstrip.sh
+
+# The infrastructure part of the key is the same for every package, and
+# hashing it is expensive, so the top level Makefile computes it once and
+# passes it down through the environment.
+pkg_cache_infra_key=$(shell ( \
+	$(call find_md5_reproducible,$(PKG_CACHE_INFRA),); \
+	$(foreach v,$(filter-out CONFIG_PKG_CACHE%,$(sort $(shell \
+		grep -ho 'CONFIG_[A-Za-z0-9_]*[A-Za-z0-9]' $(TOPDIR)/rules.mk $(INCLUDE_DIR)/*.mk))), \
+		echo '$(v)=$(subst ','\'',$(subst $(TOPDIR)/,,$($(v))))';) \
+) | $(MKHASH) sha256)
+
+ifeq ($(origin PKG_CACHE_INFRA_KEY),undefined)
+  PKG_CACHE_INFRA_KEY=$(pkg_cache_infra_key)
+endif
+
+PKG_CACHE_INPUTS = \
+	$(PKG_DIR_NAME) $(BUILD_VARIANT) $(ARCH_PACKAGES) $(DEVELOPER) \
+	$(PKG_SOURCE) $(PKG_HASH) $(PKG_MIRROR_HASH) $(PKG_SOURCE_VERSION) \
+	$(PKG_VERSION) $(PKG_RELEASE) $(ABI_VERSION) $(PKG_FLAGS) $(PKG_SOURCE_DATE_EPOCH) \
+	$(REAL_GNU_TARGET_NAME) $(GCC_VERSION) $(LIBC_TYPE) $(LIBC_VERSION) \
+	$(TARGET_CFLAGS) $(TARGET_CPPFLAGS) $(TARGET_LDFLAGS) \
+	$(LINUX_VERSION) $(LINUX_RELEASE) $(LINUX_VERMAGIC) \
+	$(if $(filter nonshared,$(PKG_FLAGS)),$(BOARD) $(SUBTARGET)) \
+	$(foreach v,$(PKG_PREPARED_DEPENDS) $(PKG_CONFIG_DEPENDS),$(v)=$($(v))) \
+	$(foreach pkg,$(Source/$(PKG_DIR_NAME)/packages),$(pkg)=$(if $(CONFIG_PACKAGE_$(pkg)),y))
+
+# Prints "<package>:<key>" for every dependency that has been built, with
+# "-" as the key for builds that were not cached.
+# 1: package names
+pkg_cache_depkeys=$(if $(strip $(1)),$(shell cd $(PKG_INFO_DIR) 2>/dev/null && for p in $(1); do \
+	if [ -s $$p.cachekey ]; then echo "$$p:$$(cat $$p.cachekey)"; \
+	elif [ -f $$p.provides ]; then echo "$$p:-"; fi; \
+done))
+
+# Paths below $(TOPDIR) are made relative so that build trees in different
+# locations arrive at the same key.
+pkg_cache_key=$(shell ( \
+	$(call find_md5_reproducible,$(CURDIR) $(PKG_FILE_DEPENDS),); \
+	$(if $(Source/$(PKG_DIR_NAME)/cachehostdirs),$(call find_md5_reproducible,$(addprefix $(TOPDIR)/,$(Source/$(PKG_DIR_NAME)/cachehostdirs)),);) \
+	echo '$(PKG_CACHE_INFRA_KEY)'; \
+	echo '$(subst ','\'',$(subst $(TOPDIR)/,,$(strip $(PKG_CACHE_INPUTS))))'; \
+	echo '$(PKG_CACHE_DEPKEYS)'; \
+) | $(MKHASH) sha256)
+
+# Evaluated once, from the first BuildPackage call, when the package
+# Makefile has set up PKG_CONFIG_DEPENDS, Build/InstallDev and friends.
+define PkgCache/Setup
+  PKG_CACHE_SETUP:=1
+  ifneq ($(CONFIG_PKG_CACHE),)
+  ifeq ($(QUILT)$(filter-out 1,$(strip $(PKG_CACHE))),)
+    PKG_CACHE_DEPKEYS:=$$(call pkg_cache_depkeys,$(Source/$(PKG_DIR_NAME)/cachedeps))
+    PKG_CACHE_KEY:=$$(if $$(filter %:-,$$(PKG_CACHE_DEPKEYS)),,$$(pkg_cache_key))
+  endif
+  endif
+
+  ifneq ($$(PKG_CACHE_KEY),)
+    PKG_CACHE_FILE:=$(PKG_CACHE_DIR)/$(PKG_DIR_NAME)/$$(PKG_CACHE_KEY).tar
+    PKG_CACHE_STAMP:=$(PKG_BUILD_DIR)/.pkgcache_$$(PKG_CACHE_KEY)
+    PKG_CACHE_HIT:=$$(wildcard $$(PKG_CACHE_FILE))
+    PKG_CACHE_STORE:=$$(if $$(PKG_CACHE_HIT),,1)
+  endif
+
+  ifneq ($$(PKG_CACHE_HIT),)
+    STAMP_BUILT:=$$(PKG_CACHE_STAMP)
+    Hooks/InstallDev/Pre:=
+    Hooks/InstallDev/Post:=
+    ifdef Build/InstallDev
+      Build/InstallDev=$$(call PkgCache/InstallDev,$$(1))
+    endif
+  endif
+
+  ifneq ($$(PKG_CACHE_STORE),)
+    STAMP_CONFIGURED:=$(STAMP_CONFIGURED)_$$(PKG_CACHE_KEY)
+    Hooks/InstallDev/Post += pkg_cache_save_stage
+  endif
+endef
+
+# Staging files often carry absolute paths (e.g. *-config scripts), these
+# are stored relative to a placeholder and fixed up on restore.
+define pkg_cache_save_stage
+	rm -rf $(PKG_CACHE_WORKDIR)/stage
+	mkdir -p $(PKG_CACHE_WORKDIR)/stage
+	$(CP) $(1)/. $(PKG_CACHE_WORKDIR)/stage/
+	grep -rlIF '$(TOPDIR)' $(PKG_CACHE_WORKDIR)/stage | $(XARGS) $(SED) 's|$(TOPDIR)|@TOPDIR@|g'
+endef
+
+define PkgCache/InstallDev
+	$(CP) $(PKG_CACHE_WORKDIR)/stage/. $(1)/
+	grep -rlIF '@TOPDIR@' $(1) | $(XARGS) $(SED) 's|@TOPDIR@|$(TOPDIR)|g'
+endef
+
+define PkgCache/Restore
+	rm -rf $(PKG_BUILD_DIR)
+	mkdir -p $(PKG_CACHE_WORKDIR)
+	$(TAR) -C $(PKG_CACHE_WORKDIR) -xf $(PKG_CACHE_FILE)
+endef
+
+# Failing to write to the cache never fails the build.
+define PkgCache/Store
+	rm -rf $(PKG_CACHE_WORKDIR)/ipk $(PKG_CACHE_WORKDIR)/info $(PKG_CACHE_WORKDIR)/pkgdir
+	mkdir -p $(PKG_CACHE_WORKDIR)/ipk $(PKG_CACHE_WORKDIR)/info $(PKG_CACHE_WORKDIR)/pkgdir
+	$(foreach pkg,$(IPKGS),
+		$(CP) $(IPKG_$(pkg)) $(PKG_CACHE_WORKDIR)/ipk/
+		$(CP) $(PKG_INFO_DIR)/$(pkg).provides $(PKG_CACHE_WORKDIR)/info/
+		$(CP) $(PKG_BUILD_DIR)/.pkgdir/$(pkg) $(PKG_CACHE_WORKDIR)/pkgdir/
+	)
+	-mkdir -p $(dir $(PKG_CACHE_FILE)) && \
+		$(TAR) -C $(PKG_CACHE_WORKDIR) --numeric-owner --owner=0 --group=0 \
+			-cf $(PKG_CACHE_FILE).$$$$ . && \
+		mv $(PKG_CACHE_FILE).$$$$ $(PKG_CACHE_FILE) || { \
+			rm -f $(PKG_CACHE_FILE).$$$$; \
+			echo "WARNING: failed to store $(PKG_DIR_NAME) in $(PKG_CACHE_DIR)" >&2; \
+		}
+	touch -r $(STAMP_BUILT) $(PKG_CACHE_STAMP)
+endef
+
+define PkgCache/Targets
+  ifneq ($(PKG_CACHE_STORE),)
+    $(PKG_CACHE_FILE): $(STAMP_BUILT)
+	$$(call PkgCache/Store)
+
+    ifdef Build/InstallDev
+      $(PKG_CACHE_FILE): $(STAMP_INSTALLED)
+    endif
+
+    compile: $(PKG_CACHE_FILE)
+  endif
+endef
@@ -118,6 +118,9 @@ ifeq ($(DUMP),)
       ifneq ($(CONFIG_PACKAGE_$(1))$(DEVELOPER),)
         IPKGS += $(1)
         $(_pkg_target)compile: $$(IPKG_$(1)) $(PKG_INFO_DIR)/$(1).provides $(PKG_BUILD_DIR)/.pkgdir/$(1).installed
+        ifneq ($(PKG_CACHE_STORE),)
+          $(PKG_CACHE_FILE): $$(IPKG_$(1)) $(PKG_INFO_DIR)/$(1).provides $(PKG_BUILD_DIR)/.pkgdir/$(1).installed
+        endif
         prepare-package-install: $$(IPKG_$(1))
         compile: $(STAGING_DIR_ROOT)/stamp/.$(1)_installed
       else
@@ -133,6 +136,13 @@ ifeq ($(DUMP),)
     else
       $(if $(CONFIG_PACKAGE_$(1)),$$(warning WARNING: skipping $(1) -- package has no install section))
     endif
+
+    ifeq ($(PKG_HOST_ONLY),)
+      compile: $(PKG_INFO_DIR)/$(1).cachekey
+    endif
+    $(PKG_INFO_DIR)/$(1).cachekey: $(STAMP_BUILT)
+	mkdir -p $(PKG_INFO_DIR)
+	$(foreach pkg,$(1) $(filter-out $(1),$(PROVIDES)),echo '$(or $(PKG_CACHE_KEY),-)' > $(PKG_INFO_DIR)/$(pkg).cachekey;)
     endif
 
     DEPENDS:=$(call PKG_FIXUP_DEPENDS,$(1),$(DEPENDS))
@@ -151,8 +161,12 @@ ifeq ($(DUMP),)
     $(PKG_BUILD_DIR)/.pkgdir/$(1).installed: $(STAMP_BUILT)
 	rm -rf $$@ $(PKG_BUILD_DIR)/.pkgdir/$(1)
 	mkdir -p $(PKG_BUILD_DIR)/.pkgdir/$(1)
+    ifneq ($(PKG_CACHE_HIT),)
+	$(CP) $(PKG_CACHE_WORKDIR)/pkgdir/$(1)/. $(PKG_BUILD_DIR)/.pkgdir/$(1)/
+    else
 	$(call Package/$(1)/install,$(PKG_BUILD_DIR)/.pkgdir/$(1))
 	$(call Package/$(1)/install_lib,$(PKG_BUILD_DIR)/.pkgdir/$(1))
+    endif
 	touch $$@
 
     $(STAGING_DIR_ROOT)/stamp/.$(1)_installed: $(PKG_BUILD_DIR)/.pkgdir/$(1).installed
@@ -198,6 +212,15 @@ $(_endef)
     $$(IPKG_$(1)) : export DESCRIPTION=$$(Package/$(1)/description)
     $$(IPKG_$(1)) : export PATH=$$(TARGET_PATH_PKG)
     $$(IPKG_$(1)) : export PKG_SOURCE_DATE_EPOCH:=$(PKG_SOURCE_DATE_EPOCH)
+    ifneq ($(PKG_CACHE_HIT),)
+    $(PKG_INFO_DIR)/$(1).provides $$(IPKG_$(1)): $(STAMP_BUILT)
+	@rm -rf $$(IDIR_$(1)); \
+		$$(call remove_ipkg_files,$(1),$$(call opkg_package_files,$(call gen_ipkg_wildcard,$(1))))
+	mkdir -p $(PKG_INFO_DIR) $$(PDIR_$(1))
+	$(INSTALL_DATA) $(PKG_CACHE_WORKDIR)/info/$(1).provides $(PKG_INFO_DIR)/
+	$(if $(PROVIDES),@for pkg in $(filter-out $(1),$(PROVIDES)); do cp $(PKG_INFO_DIR)/$(1).provides $(PKG_INFO_DIR)/$$$$pkg.provides; done)
+	$(INSTALL_DATA) $(PKG_CACHE_WORKDIR)/ipk/$$(notdir $$(IPKG_$(1))) $$(PDIR_$(1))/
+    else
     $(PKG_INFO_DIR)/$(1).provides $$(IPKG_$(1)): $(STAMP_BUILT) $(INCLUDE_DIR)/package-ipkg.mk
 	@rm -rf $$(IDIR_$(1)); \
 		$$(call remove_ipkg_files,$(1),$$(call opkg_package_files,$(call gen_ipkg_wildcard,$(1))))
@@ -266,6 +289,7 @@ $(_endef)
 	$(INSTALL_DIR) $$(PDIR_$(1))
 	$(FAKEROOT) $(STAGING_DIR_HOST)/bin/bash $(SCRIPT_DIR)/ipkg-build -m "$(FILE_MODES)" $$(IDIR_$(1)) $$(PDIR_$(1))
 	@[ -f $$(IPKG_$(1)) ]
+    endif
 
     $(1)-clean:
 	$$(call remove_ipkg_files,$(1),$$(call opkg_package_files,$(call gen_ipkg_wildcard,$(1))))
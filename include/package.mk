@@ -112,6 +112,7 @@ include $(INCLUDE_DIR)/package-defaults.mk
 include $(INCLUDE_DIR)/package-dumpinfo.mk
 include $(INCLUDE_DIR)/package-ipkg.mk
 include $(INCLUDE_DIR)/package-bin.mk
+include $(INCLUDE_DIR)/package-cache.mk
 include $(INCLUDE_DIR)/autotools.mk
 
 _pkg_target:=$(if $(QUILT),,.)
@@ -210,6 +211,11 @@ define Build/CoreTargets
 	$(foreach hook,$(Hooks/Configure/Post),$(call $(hook))$(sep))
 	touch $$@
 
+  ifneq ($(PKG_CACHE_HIT),)
+  $(STAMP_BUILT): | $(PKG_CACHE_FILE)
+	$(PkgCache/Restore)
+	touch $$@
+  else
   $(call Build/Exports,$(STAMP_BUILT))
   $(STAMP_BUILT): $(STAMP_CONFIGURED) $(STAMP_BUILT_DEPENDS)
 	rm -f $$@
@@ -220,6 +226,8 @@ define Build/CoreTargets
 	$(Build/Install)
 	$(foreach hook,$(Hooks/Install/Post),$(call $(hook))$(sep))
 	touch $$@
+  endif
+  $(PkgCache/Targets)
 
   $(STAMP_INSTALLED) : export PATH=$$(TARGET_PATH_PKG)
   $(STAMP_INSTALLED): $(STAMP_BUILT)
@@ -273,6 +281,7 @@ define Build/DefaultTargets
 endef
 
 define BuildPackage
+  $(if $(DUMP)$(PKG_CACHE_SETUP),,$(eval $(PkgCache/Setup)))
   $(eval $(Package/Default))
   $(eval $(Package/$(1)))
 
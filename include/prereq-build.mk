@@ -225,7 +225,13 @@ $(STAGING_DIR_HOST)/bin/mkhash: $(SCRIPT_DIR)/mkhash.c
 $(STAGING_DIR_HOST)/bin/xxd: $(SCRIPT_DIR)/xxdi.pl
 	$(LN) $< $@
 
-prereq: $(STAGING_DIR_HOST)/bin/mkhash $(STAGING_DIR_HOST)/bin/xxd
+$(STAGING_DIR_HOST)/bin/kconfig-merge: $(wildcard $(SCRIPT_DIR)/config/*.[ch])
+	mkdir -p $(dir $@)
+	$(MAKE) -s -C $(SCRIPT_DIR)/config kconfig-merge CFLAGS=-O2
+	$(CP) $(SCRIPT_DIR)/config/kconfig-merge $@
+
+prereq: $(STAGING_DIR_HOST)/bin/mkhash $(STAGING_DIR_HOST)/bin/xxd \
+	$(STAGING_DIR_HOST)/bin/kconfig-merge
 
 # Install ldconfig stub
 $(eval $(call TestHostCommand,ldconfig-stub,Failed to install stub, \
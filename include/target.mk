@@ -201,8 +201,12 @@ endif
 
 __linux_confcmd = $(2) $(patsubst %,+,$(wordlist 2,9999,$(1))) $(1)
 
-LINUX_CONF_CMD = $(SCRIPT_DIR)/kconfig.pl $(call __linux_confcmd,$(LINUX_KCONFIG_LIST))
-LINUX_RECONF_CMD = $(SCRIPT_DIR)/kconfig.pl $(call __linux_confcmd,$(LINUX_RECONFIG_LIST))
+# config-filter needs Perl regular expressions, so LINUX_RECONF_DIFF keeps
+# using kconfig.pl
+KCONFIG_MERGE = $(firstword $(wildcard $(STAGING_DIR_HOST)/bin/kconfig-merge) $(SCRIPT_DIR)/kconfig.pl)
+
+LINUX_CONF_CMD = $(KCONFIG_MERGE) $(call __linux_confcmd,$(LINUX_KCONFIG_LIST))
+LINUX_RECONF_CMD = $(KCONFIG_MERGE) $(call __linux_confcmd,$(LINUX_RECONFIG_LIST))
 LINUX_RECONF_DIFF = $(SCRIPT_DIR)/kconfig.pl - '>' $(call __linux_confcmd,$(filter-out $(LINUX_RECONFIG_TARGET),$(LINUX_RECONFIG_LIST))) $(1) $(GENERIC_PLATFORM_DIR)/config-filter
 
 ifeq ($(DUMP),1)
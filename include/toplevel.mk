@@ -98,6 +98,8 @@ prepare-tmpinfo: FORCE
 ifeq ($(RECURSIVE_DEP_IS_ERROR),1)
   KCONF_FLAGS=--fatalrecursive
 endif
+KCONFIG_CACHE ?= $(TOPDIR)/tmp/.config-cache
+export KCONFIG_CACHE
 ifneq ($(DISTRO_PKG_CONFIG),)
 scripts/config/%onf: export PATH:=$(dir $(DISTRO_PKG_CONFIG)):$(PATH)
 endif
@@ -259,7 +261,7 @@ help:
 	cat README.md
 
 distclean:
-	rm -rf bin build_dir .ccache .config* dl feeds key-build* logs package/feeds staging_dir tmp
+	rm -rf bin build_dir .ccache .pkgcache .config* dl feeds key-build* logs package/feeds staging_dir tmp
 	@$(_SINGLE)$(SUBMAKE) -C scripts/config clean
 
 ifeq ($(findstring v,$(DEBUG)),)
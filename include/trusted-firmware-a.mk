@@ -10,6 +10,7 @@ PKG_BUILD_DIR = $(BUILD_DIR)/$(PKG_NAME)-$(BUILD_VARIANT)/$(PKG_NAME)-$(PKG_VERS
 
 PKG_TARGETS := bin
 PKG_FLAGS:=nonshared
+PKG_CACHE:=0
 
 PKG_LICENSE:=BSD-3-Clause
 PKG_LICENSE_FILES:=docs/license.rst
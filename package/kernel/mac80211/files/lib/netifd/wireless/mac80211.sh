@@ -1225,8 +1225,15 @@ drv_mac80211_setup() {
 	for_each_interface "ap" mac80211_prepare_vif
 	NEW_MD5=$(test -e "${hostapd_conf_file}" && md5sum ${hostapd_conf_file})
 	OLD_MD5=$(uci -q -P /var/state get wireless._${phy}.md5)
+	local set_ap=
 	if [ "${NEWAPLIST}" != "${OLDAPLIST}" ]; then
-		mac80211_vap_cleanup hostapd "${OLDAPLIST}"
+		# hostapd adds and removes the BSSes of a running radio in one go
+		if [ -n "$hostapd_ctrl" ] && [ "${NEWAPLIST%% *}" = "${OLDAPLIST%% *}" ] &&
+		   [ -n "$(ubus list | grep hostapd.${NEWAPLIST%% *})" ]; then
+			set_ap=1
+		else
+			mac80211_vap_cleanup hostapd "${OLDAPLIST}"
+		fi
 	fi
 	[ -n "${NEWAPLIST}" ] && mac80211_iw_interface_add "$phy" "${NEWAPLIST%% *}" __ap
 	local add_ap=0
@@ -1235,8 +1242,12 @@ drv_mac80211_setup() {
 		local no_reload=1
 		if [ -n "$(ubus list | grep hostapd.$primary_ap)" ]; then
 			no_reload=0
-			[ "${NEW_MD5}" = "${OLD_MD5}" ] || {
-				ubus call hostapd.$primary_ap reload
+			[ -z "$set_ap" ] && [ "${NEW_MD5}" = "${OLD_MD5}" ] || {
+				if [ -n "$set_ap" ]; then
+					ubus call hostapd config_set "{\"iface\":\"$primary_ap\", \"config\":\"${hostapd_conf_file}\"}" >/dev/null
+				else
+					ubus call hostapd.$primary_ap reload
+				fi
 				no_reload=$?
 				if [ "$no_reload" != "0" ]; then
 					mac80211_vap_cleanup hostapd "${OLDAPLIST}"
@@ -0,0 +1,1055 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * packet-steeringd - adaptive IRQ affinity, RPS and XPS placement
+ *
+ * Periodically samples interrupt counts of network devices and the NET_RX
+ * softirq load of every CPU, moves device IRQs to the least loaded CPUs and
+ * derives RPS/XPS masks from the resulting placement and the CPU topology.
+ */
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libubox/list.h>
+#include <libubox/uloop.h>
+#include <libubox/ulog.h>
+#include <libubus.h>
+
+#define PS_MAX_CPUS		64
+#define PS_DEFAULT_INTERVAL	5
+#define PS_DEFAULT_THRESHOLD	1000
+#define PS_DEFAULT_HYSTERESIS	25
+
+struct ps_cpu {
+	int cluster;
+	uint64_t net_rx;
+	unsigned int net_rx_rate;
+	unsigned int irq_rate;
+	unsigned int load;
+};
+
+struct ps_dev {
+	struct list_head list;
+	struct list_head irqs;
+
+	char name[32];
+	char bus[64];
+	bool dsa;
+	bool seen;
+	bool rps_active;
+
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	unsigned int rx_rate;
+	unsigned int tx_rate;
+
+	int n_rx;
+	int n_tx;
+	uint64_t *rps;
+	uint64_t *xps;
+};
+
+struct ps_irq {
+	struct list_head list;
+	struct ps_dev *dev;
+
+	int irq;
+	char name[64];
+	int cpu;
+	bool seen;
+	bool fixed;
+
+	uint64_t count;
+	uint64_t cpu_count[PS_MAX_CPUS];
+	unsigned int rate;
+};
+
+static struct ps_cpu cpus[PS_MAX_CPUS];
+static uint64_t online_mask;
+static int n_cpus;
+
+static LIST_HEAD(devs);
+static struct timespec last_run;
+
+static int interval = PS_DEFAULT_INTERVAL;
+static unsigned int rps_threshold = PS_DEFAULT_THRESHOLD;
+static unsigned int hysteresis = PS_DEFAULT_HYSTERESIS;
+
+static struct {
+	uint64_t runs;
+	uint64_t irq_moves;
+	uint64_t rps_updates;
+	uint64_t xps_updates;
+	uint64_t write_errors;
+} stats;
+
+static struct ubus_auto_conn conn;
+static struct blob_buf b;
+
+static int
+ps_read_file(const char *path, char *buf, size_t len)
+{
+	FILE *f;
+	size_t n;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	n = fread(buf, 1, len - 1, f);
+	fclose(f);
+
+	while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+		n--;
+	buf[n] = 0;
+
+	return n;
+}
+
+static int
+ps_read_int(const char *path, int def)
+{
+	char buf[32];
+
+	if (ps_read_file(path, buf, sizeof(buf)) <= 0)
+		return def;
+
+	return atoi(buf);
+}
+
+static uint64_t
+ps_read_u64(const char *path)
+{
+	char buf[32];
+
+	if (ps_read_file(path, buf, sizeof(buf)) <= 0)
+		return 0;
+
+	return strtoull(buf, NULL, 10);
+}
+
+static const char *
+ps_mask_str(uint64_t mask)
+{
+	static char buf[24];
+
+	if (mask >> 32)
+		snprintf(buf, sizeof(buf), "%x,%08x",
+			 (unsigned int)(mask >> 32), (unsigned int)mask);
+	else
+		snprintf(buf, sizeof(buf), "%x", (unsigned int)mask);
+
+	return buf;
+}
+
+static bool
+ps_write_mask(const char *path, uint64_t mask)
+{
+	const char *val = ps_mask_str(mask);
+	FILE *f;
+	int ret;
+
+	f = fopen(path, "w");
+	if (!f)
+		goto error;
+
+	ret = fputs(val, f);
+	if (fclose(f) || ret < 0)
+		goto error;
+
+	return true;
+
+error:
+	stats.write_errors++;
+	ULOG_WARN("Failed to write %s to %s: %s\n", val, path, strerror(errno));
+	return false;
+}
+
+static unsigned int
+ps_rate(uint64_t prev, uint64_t cur, double dt)
+{
+	/* no rate on the first sample of a counter */
+	if (!prev || cur < prev || dt <= 0)
+		return 0;
+
+	return (cur - prev) / dt;
+}
+
+static void
+ps_topology_init(void)
+{
+	char path[128];
+	struct stat st;
+	int cluster;
+	int i;
+
+	for (i = 0; i < PS_MAX_CPUS; i++) {
+		/* offline CPUs have no topology directory */
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology", i);
+		if (stat(path, &st))
+			continue;
+
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/cluster_id", i);
+		cluster = ps_read_int(path, -1);
+		if (cluster < 0) {
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", i);
+			cluster = ps_read_int(path, 0);
+		}
+
+		cpus[i].cluster = cluster < 0 ? 0 : cluster;
+		online_mask |= 1ULL << i;
+		n_cpus = i + 1;
+	}
+}
+
+static uint64_t
+ps_cluster_mask(int cpu)
+{
+	uint64_t mask = 0;
+	int i;
+
+	for (i = 0; i < n_cpus; i++)
+		if ((online_mask & (1ULL << i)) && cpus[i].cluster == cpus[cpu].cluster)
+			mask |= 1ULL << i;
+
+	return mask;
+}
+
+static int
+ps_count_queues(const char *dev, const char *prefix)
+{
+	char path[128];
+	struct dirent *e;
+	DIR *d;
+	int n = 0;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/queues", dev);
+	d = opendir(path);
+	if (!d)
+		return 0;
+
+	while ((e = readdir(d)) != NULL)
+		if (!strncmp(e->d_name, prefix, strlen(prefix)))
+			n++;
+
+	closedir(d);
+
+	return n;
+}
+
+static bool
+ps_dev_is_virtual(const char *dev)
+{
+	char path[128];
+	struct dirent *e;
+	struct stat st;
+	bool ret = false;
+	DIR *d;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device", dev);
+	if (stat(path, &st))
+		return true;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s", dev);
+	d = opendir(path);
+	if (!d)
+		return true;
+
+	while ((e = readdir(d)) != NULL) {
+		if (!strncmp(e->d_name, "lower_", 6)) {
+			ret = true;
+			break;
+		}
+	}
+
+	closedir(d);
+
+	return ret;
+}
+
+static const char *
+ps_link_basename(const char *path)
+{
+	static char buf[PATH_MAX];
+	const char *p;
+	ssize_t len;
+
+	len = readlink(path, buf, sizeof(buf) - 1);
+	if (len < 0)
+		return "";
+
+	buf[len] = 0;
+	p = strrchr(buf, '/');
+
+	return p ? p + 1 : buf;
+}
+
+static uint64_t *
+ps_mask_alloc(uint64_t *masks, int n)
+{
+	int i;
+
+	free(masks);
+	if (!n)
+		return NULL;
+
+	masks = calloc(n, sizeof(*masks));
+	if (!masks)
+		return NULL;
+
+	/* not written yet */
+	for (i = 0; i < n; i++)
+		masks[i] = ~0ULL;
+
+	return masks;
+}
+
+static void
+ps_dev_set_queues(struct ps_dev *dev, int n_rx, int n_tx)
+{
+	if (dev->n_rx == n_rx && dev->n_tx == n_tx)
+		return;
+
+	/* queue count changed (e.g. ethtool -L), rewrite all masks */
+	dev->rps = ps_mask_alloc(dev->rps, n_rx);
+	dev->xps = ps_mask_alloc(dev->xps, n_tx);
+	dev->n_rx = dev->rps ? n_rx : 0;
+	dev->n_tx = dev->xps ? n_tx : 0;
+}
+
+static void
+ps_irq_free(struct ps_irq *irq)
+{
+	list_del(&irq->list);
+	free(irq);
+}
+
+static void
+ps_dev_free(struct ps_dev *dev)
+{
+	struct ps_irq *irq, *tmp;
+
+	list_for_each_entry_safe(irq, tmp, &dev->irqs, list)
+		ps_irq_free(irq);
+
+	list_del(&dev->list);
+	free(dev->rps);
+	free(dev->xps);
+	free(dev);
+}
+
+static struct ps_dev *
+ps_dev_get(const char *name)
+{
+	struct ps_dev *dev;
+
+	list_for_each_entry(dev, &devs, list)
+		if (!strcmp(dev->name, name))
+			return dev;
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev)
+		return NULL;
+
+	snprintf(dev->name, sizeof(dev->name), "%s", name);
+	INIT_LIST_HEAD(&dev->irqs);
+	list_add_tail(&dev->list, &devs);
+
+	return dev;
+}
+
+static void
+ps_scan_devs(double dt)
+{
+	struct ps_dev *dev, *tmp;
+	char path[128];
+	struct dirent *e;
+	uint64_t val;
+	DIR *d;
+
+	list_for_each_entry(dev, &devs, list)
+		dev->seen = false;
+
+	d = opendir("/sys/class/net");
+	if (!d)
+		return;
+
+	while ((e = readdir(d)) != NULL) {
+		if (e->d_name[0] == '.' || strlen(e->d_name) >= sizeof(dev->name))
+			continue;
+
+		if (ps_dev_is_virtual(e->d_name))
+			continue;
+
+		dev = ps_dev_get(e->d_name);
+		if (!dev)
+			continue;
+
+		dev->seen = true;
+
+		snprintf(path, sizeof(path), "/sys/class/net/%s/device", dev->name);
+		snprintf(dev->bus, sizeof(dev->bus), "%s", ps_link_basename(path));
+
+		snprintf(path, sizeof(path), "/sys/class/net/%s/device/subsystem", dev->name);
+		dev->dsa = !strcmp(ps_link_basename(path), "mdio_bus");
+
+		ps_dev_set_queues(dev, ps_count_queues(dev->name, "rx-"),
+				  ps_count_queues(dev->name, "tx-"));
+
+		snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/rx_packets", dev->name);
+		val = ps_read_u64(path);
+		dev->rx_rate = ps_rate(dev->rx_packets, val, dt);
+		dev->rx_packets = val;
+
+		snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/tx_packets", dev->name);
+		val = ps_read_u64(path);
+		dev->tx_rate = ps_rate(dev->tx_packets, val, dt);
+		dev->tx_packets = val;
+	}
+
+	closedir(d);
+
+	list_for_each_entry_safe(dev, tmp, &devs, list)
+		if (!dev->seen)
+			ps_dev_free(dev);
+}
+
+static int
+ps_parse_cpu_header(const char *line, int *cols)
+{
+	int n = 0;
+	int cpu;
+
+	while (n < PS_MAX_CPUS && (line = strstr(line, "CPU")) != NULL) {
+		line += 3;
+		if (sscanf(line, "%d", &cpu) == 1 && cpu >= 0 && cpu < PS_MAX_CPUS)
+			cols[n++] = cpu;
+	}
+
+	return n;
+}
+
+static int
+ps_parse_cpu_counts(char **str, const int *cols, int n_cols, uint64_t *counts)
+{
+	char *p = *str, *end;
+	int i;
+
+	memset(counts, 0, PS_MAX_CPUS * sizeof(*counts));
+	for (i = 0; i < n_cols; i++) {
+		counts[cols[i]] = strtoull(p, &end, 10);
+		if (end == p)
+			return -1;
+		p = end;
+	}
+
+	*str = p;
+
+	return 0;
+}
+
+static bool
+ps_name_match(const char *name, const char *match)
+{
+	size_t len = strlen(match);
+	size_t name_len = strlen(name);
+
+	if (!len)
+		return false;
+
+	/* "eth0", "eth0-rx-1", or "...1e100000.ethernet" */
+	if (!strncmp(name, match, len) && (!name[len] || name[len] == '-'))
+		return true;
+
+	return name_len > len && !strcmp(name + name_len - len, match);
+}
+
+static struct ps_dev *
+ps_irq_dev(const char *name)
+{
+	struct ps_dev *dev;
+
+	list_for_each_entry(dev, &devs, list)
+		if (ps_name_match(name, dev->name))
+			return dev;
+
+	list_for_each_entry(dev, &devs, list)
+		if (ps_name_match(name, dev->bus))
+			return dev;
+
+	return NULL;
+}
+
+static struct ps_irq *
+ps_irq_get(struct ps_dev *dev, int nr, const char *name)
+{
+	struct ps_irq *irq;
+
+	list_for_each_entry(irq, &dev->irqs, list)
+		if (irq->irq == nr)
+			return irq;
+
+	irq = calloc(1, sizeof(*irq));
+	if (!irq)
+		return NULL;
+
+	irq->dev = dev;
+	irq->irq = nr;
+	irq->cpu = -1;
+	snprintf(irq->name, sizeof(irq->name), "%s", name);
+	list_add_tail(&irq->list, &dev->irqs);
+
+	return irq;
+}
+
+static void
+ps_irq_update(struct ps_irq *irq, const uint64_t *counts, double dt)
+{
+	uint64_t delta, max = 0, total = 0;
+	int i, cpu = -1;
+
+	for (i = 0; i < n_cpus; i++) {
+		total += counts[i];
+
+		/*
+		 * the CPU that took most interrupts since the last run,
+		 * or in total on the first sample
+		 */
+		delta = counts[i] >= irq->cpu_count[i] ? counts[i] - irq->cpu_count[i] : 0;
+		if (delta > max) {
+			max = delta;
+			cpu = i;
+		}
+		irq->cpu_count[i] = counts[i];
+	}
+
+	irq->rate = ps_rate(irq->count, total, dt);
+	irq->count = total;
+	irq->seen = true;
+
+	if (cpu >= 0)
+		irq->cpu = cpu;
+}
+
+static void
+ps_scan_irqs(double dt)
+{
+	uint64_t counts[PS_MAX_CPUS];
+	int cols[PS_MAX_CPUS];
+	struct ps_irq *irq, *tmp;
+	struct ps_dev *dev;
+	char *line = NULL;
+	size_t len = 0;
+	int n_cols = 0;
+	FILE *f;
+
+	list_for_each_entry(dev, &devs, list)
+		list_for_each_entry(irq, &dev->irqs, list)
+			irq->seen = false;
+
+	f = fopen("/proc/interrupts", "r");
+	if (!f)
+		return;
+
+	if (getline(&line, &len, f) > 0)
+		n_cols = ps_parse_cpu_header(line, cols);
+
+	while (getline(&line, &len, f) > 0) {
+		char *p, *end, *name;
+		int nr;
+
+		nr = strtol(line, &p, 10);
+		if (p == line || *p != ':')
+			continue;
+
+		p++;
+		if (ps_parse_cpu_counts(&p, cols, n_cols, counts))
+			continue;
+
+		end = p + strlen(p);
+		while (end > p && (end[-1] == '\n' || end[-1] == ' '))
+			*(--end) = 0;
+
+		name = strrchr(p, ' ');
+		name = name ? name + 1 : p;
+
+		dev = ps_irq_dev(name);
+		if (!dev)
+			continue;
+
+		irq = ps_irq_get(dev, nr, name);
+		if (irq)
+			ps_irq_update(irq, counts, dt);
+	}
+
+	free(line);
+	fclose(f);
+
+	list_for_each_entry(dev, &devs, list)
+		list_for_each_entry_safe(irq, tmp, &dev->irqs, list)
+			if (!irq->seen)
+				ps_irq_free(irq);
+}
+
+static void
+ps_scan_softirqs(double dt)
+{
+	uint64_t counts[PS_MAX_CPUS];
+	int cols[PS_MAX_CPUS];
+	char *line = NULL;
+	size_t len = 0;
+	int n_cols = 0;
+	FILE *f;
+	int i;
+
+	f = fopen("/proc/softirqs", "r");
+	if (!f)
+		return;
+
+	if (getline(&line, &len, f) > 0)
+		n_cols = ps_parse_cpu_header(line, cols);
+
+	while (getline(&line, &len, f) > 0) {
+		char *p = strstr(line, "NET_RX:");
+
+		if (!p)
+			continue;
+
+		p += strlen("NET_RX:");
+		if (ps_parse_cpu_counts(&p, cols, n_cols, counts))
+			break;
+
+		for (i = 0; i < n_cpus; i++) {
+			cpus[i].net_rx_rate = ps_rate(cpus[i].net_rx, counts[i], dt);
+			cpus[i].net_rx = counts[i];
+		}
+		break;
+	}
+
+	free(line);
+	fclose(f);
+}
+
+static int
+ps_irq_cmp(const void *a, const void *b)
+{
+	const struct ps_irq *ia = *(const struct ps_irq **)a;
+	const struct ps_irq *ib = *(const struct ps_irq **)b;
+
+	if (ia->rate != ib->rate)
+		return ia->rate < ib->rate ? 1 : -1;
+
+	return ia->irq - ib->irq;
+}
+
+static bool
+ps_irq_move(struct ps_irq *irq, int cpu)
+{
+	char path[64];
+
+	snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity", irq->irq);
+	if (!ps_write_mask(path, 1ULL << cpu))
+		return false;
+
+	ULOG_INFO("Moving IRQ %d (%s) from CPU %d to CPU %d\n",
+		  irq->irq, irq->name, irq->cpu, cpu);
+	irq->cpu = cpu;
+	stats.irq_moves++;
+
+	return true;
+}
+
+/*
+ * Greedy placement: IRQs are assigned busiest first to the CPU with the
+ * lowest load, starting from the NET_RX softirq load that is not caused by
+ * the IRQs themselves (RPS, other devices). An IRQ stays where it is unless
+ * that is worse than the best choice by more than the hysteresis.
+ */
+static void
+ps_balance_irqs(void)
+{
+	unsigned int load[PS_MAX_CPUS] = {};
+	struct ps_irq **list, *irq;
+	struct ps_dev *dev;
+	int n_irqs = 0;
+	int i, cpu;
+
+	list_for_each_entry(dev, &devs, list)
+		list_for_each_entry(irq, &dev->irqs, list)
+			n_irqs++;
+
+	for (i = 0; i < n_cpus; i++)
+		cpus[i].irq_rate = 0;
+
+	list = calloc(n_irqs + 1, sizeof(*list));
+	if (!list)
+		return;
+
+	n_irqs = 0;
+	list_for_each_entry(dev, &devs, list) {
+		list_for_each_entry(irq, &dev->irqs, list) {
+			list[n_irqs++] = irq;
+			if (irq->cpu >= 0)
+				cpus[irq->cpu].irq_rate += irq->rate;
+		}
+	}
+
+	qsort(list, n_irqs, sizeof(*list), ps_irq_cmp);
+
+	for (i = 0; i < n_cpus; i++)
+		if (cpus[i].net_rx_rate > cpus[i].irq_rate)
+			load[i] = cpus[i].net_rx_rate - cpus[i].irq_rate;
+
+	for (i = 0; i < n_irqs; i++) {
+		unsigned int weight;
+		int best = -1;
+
+		irq = list[i];
+		weight = irq->rate + 1;
+
+		for (cpu = 0; cpu < n_cpus; cpu++) {
+			if (!(online_mask & (1ULL << cpu)))
+				continue;
+
+			if (best < 0 || load[cpu] < load[best])
+				best = cpu;
+		}
+
+		cpu = irq->cpu;
+		if (!irq->fixed &&
+		    (cpu < 0 || !(online_mask & (1ULL << cpu)) ||
+		     (uint64_t)(load[cpu] + weight) * 100 >
+		     (uint64_t)(load[best] + weight) * (100 + hysteresis)))
+			cpu = best;
+
+		if (cpu != irq->cpu && !ps_irq_move(irq, cpu)) {
+			/* e.g. per-CPU or chained interrupts */
+			irq->fixed = true;
+			cpu = irq->cpu;
+		}
+
+		if (cpu >= 0)
+			load[cpu] += weight;
+	}
+
+	free(list);
+
+	for (i = 0; i < n_cpus; i++) {
+		cpus[i].irq_rate = 0;
+		cpus[i].load = load[i];
+	}
+
+	list_for_each_entry(dev, &devs, list)
+		list_for_each_entry(irq, &dev->irqs, list)
+			if (irq->cpu >= 0)
+				cpus[irq->cpu].irq_rate += irq->rate;
+}
+
+static void
+ps_set_queue_mask(struct ps_dev *dev, const char *type, int queue,
+		  uint64_t *cur, uint64_t mask, uint64_t *counter)
+{
+	char path[128];
+
+	if (*cur == mask)
+		return;
+
+	/* remember failed writes as well to avoid retrying every run */
+	*cur = mask;
+	snprintf(path, sizeof(path), "/sys/class/net/%s/queues/%s-%d/%s_cpus",
+		 dev->name, type, queue, !strcmp(type, "rx") ? "rps" : "xps");
+	if (ps_write_mask(path, mask))
+		(*counter)++;
+}
+
+static void
+ps_update_rps(struct ps_dev *dev)
+{
+	struct ps_irq *irq, *busiest = NULL;
+	uint64_t irq_mask = 0, mask = 0;
+	int n_irqs = 0;
+	int i;
+
+	/* ignore dsa user ports, the conduit interface does the work */
+	if (dev->dsa)
+		return;
+
+	list_for_each_entry(irq, &dev->irqs, list) {
+		n_irqs++;
+		if (irq->cpu < 0)
+			continue;
+
+		irq_mask |= 1ULL << irq->cpu;
+		if (!busiest || irq->rate > busiest->rate)
+			busiest = irq;
+	}
+
+	if (dev->rx_rate >= rps_threshold)
+		dev->rps_active = true;
+	else if (dev->rx_rate < rps_threshold / 2)
+		dev->rps_active = false;
+
+	/*
+	 * Steering costs an IPI and a cache miss per packet, it only pays off
+	 * when the IRQ CPU can not keep up. Devices with an IRQ per rx queue
+	 * are already spread by the hardware.
+	 */
+	if (!dev->rps_active || (dev->n_rx > 1 && n_irqs >= dev->n_rx))
+		mask = 0;
+	else if (!busiest)
+		mask = online_mask;
+	else if (!(mask = ps_cluster_mask(busiest->cpu) & ~irq_mask))
+		mask = online_mask & ~irq_mask;
+
+	for (i = 0; i < dev->n_rx; i++)
+		ps_set_queue_mask(dev, "rx", i, &dev->rps[i], mask, &stats.rps_updates);
+}
+
+static void
+ps_update_xps(struct ps_dev *dev)
+{
+	int order[PS_MAX_CPUS];
+	int n = 0;
+	int i, j, q;
+
+	if (!dev->n_tx)
+		return;
+
+	/* CPUs sorted by cluster, so that each tx queue stays within one */
+	for (i = 0; i < n_cpus; i++) {
+		if (!(online_mask & (1ULL << i)))
+			continue;
+
+		for (j = n; j > 0 && cpus[order[j - 1]].cluster > cpus[i].cluster; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		n++;
+	}
+
+	for (q = 0; q < dev->n_tx; q++) {
+		uint64_t mask = 0;
+
+		if (dev->n_tx == 1)
+			mask = online_mask;
+		else if (n < dev->n_tx)
+			mask = 1ULL << order[q % n];
+		else
+			for (i = 0; i < n; i++)
+				if (i * dev->n_tx / n == q)
+					mask |= 1ULL << order[i];
+
+		ps_set_queue_mask(dev, "tx", q, &dev->xps[q], mask, &stats.xps_updates);
+	}
+}
+
+static void
+ps_run(void)
+{
+	struct timespec now;
+	struct ps_dev *dev;
+	double dt = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (last_run.tv_sec)
+		dt = (now.tv_sec - last_run.tv_sec) +
+		     (now.tv_nsec - last_run.tv_nsec) / 1e9;
+	last_run = now;
+
+	ps_scan_devs(dt);
+	ps_scan_irqs(dt);
+	ps_scan_softirqs(dt);
+	stats.runs++;
+
+	/* nothing to balance on a single CPU */
+	if (!(online_mask & (online_mask - 1)))
+		return;
+
+	ps_balance_irqs();
+
+	list_for_each_entry(dev, &devs, list) {
+		ps_update_rps(dev);
+		ps_update_xps(dev);
+	}
+}
+
+static void
+ps_timer_cb(struct uloop_timeout *t)
+{
+	ps_run();
+	uloop_timeout_set(t, interval * 1000);
+}
+
+static struct uloop_timeout run_timer = {
+	.cb = ps_timer_cb,
+};
+
+static void
+ps_add_masks(const char *name, const uint64_t *masks, int n)
+{
+	void *a;
+	int i;
+
+	a = blobmsg_open_array(&b, name);
+	for (i = 0; i < n; i++)
+		blobmsg_add_string(&b, NULL, masks[i] == ~0ULL ? "" : ps_mask_str(masks[i]));
+	blobmsg_close_array(&b, a);
+}
+
+static int
+ps_status(struct ubus_context *ctx, struct ubus_object *obj,
+	  struct ubus_request_data *req, const char *method,
+	  struct blob_attr *msg)
+{
+	struct ps_irq *irq;
+	struct ps_dev *dev;
+	void *c, *d, *a, *t;
+	int i;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "interval", interval);
+	blobmsg_add_u32(&b, "rps_threshold", rps_threshold);
+	blobmsg_add_u32(&b, "hysteresis", hysteresis);
+	blobmsg_add_u64(&b, "runs", stats.runs);
+	blobmsg_add_u64(&b, "irq_moves", stats.irq_moves);
+	blobmsg_add_u64(&b, "rps_updates", stats.rps_updates);
+	blobmsg_add_u64(&b, "xps_updates", stats.xps_updates);
+	blobmsg_add_u64(&b, "write_errors", stats.write_errors);
+
+	a = blobmsg_open_array(&b, "cpus");
+	for (i = 0; i < n_cpus; i++) {
+		if (!(online_mask & (1ULL << i)))
+			continue;
+
+		c = blobmsg_open_table(&b, NULL);
+		blobmsg_add_u32(&b, "cpu", i);
+		blobmsg_add_u32(&b, "cluster", cpus[i].cluster);
+		blobmsg_add_u32(&b, "irq_rate", cpus[i].irq_rate);
+		blobmsg_add_u32(&b, "net_rx_rate", cpus[i].net_rx_rate);
+		blobmsg_add_u32(&b, "load", cpus[i].load);
+		blobmsg_close_table(&b, c);
+	}
+	blobmsg_close_array(&b, a);
+
+	d = blobmsg_open_table(&b, "devices");
+	list_for_each_entry(dev, &devs, list) {
+		c = blobmsg_open_table(&b, dev->name);
+		blobmsg_add_u32(&b, "rx_pps", dev->rx_rate);
+		blobmsg_add_u32(&b, "tx_pps", dev->tx_rate);
+		blobmsg_add_u8(&b, "dsa", dev->dsa);
+		blobmsg_add_u8(&b, "rps", dev->rps_active);
+
+		a = blobmsg_open_array(&b, "irqs");
+		list_for_each_entry(irq, &dev->irqs, list) {
+			t = blobmsg_open_table(&b, NULL);
+			blobmsg_add_u32(&b, "irq", irq->irq);
+			blobmsg_add_string(&b, "name", irq->name);
+			if (irq->cpu >= 0)
+				blobmsg_add_u32(&b, "cpu", irq->cpu);
+			blobmsg_add_u32(&b, "rate", irq->rate);
+			blobmsg_add_u8(&b, "fixed", irq->fixed);
+			blobmsg_close_table(&b, t);
+		}
+		blobmsg_close_array(&b, a);
+
+		ps_add_masks("rps_cpus", dev->rps, dev->n_rx);
+		ps_add_masks("xps_cpus", dev->xps, dev->n_tx);
+		blobmsg_close_table(&b, c);
+	}
+	blobmsg_close_table(&b, d);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
+static int
+ps_rebalance(struct ubus_context *ctx, struct ubus_object *obj,
+	     struct ubus_request_data *req, const char *method,
+	     struct blob_attr *msg)
+{
+	uloop_timeout_cancel(&run_timer);
+	ps_timer_cb(&run_timer);
+
+	return ps_status(ctx, obj, req, method, msg);
+}
+
+static const struct ubus_method ps_methods[] = {
+	UBUS_METHOD_NOARG("status", ps_status),
+	UBUS_METHOD_NOARG("rebalance", ps_rebalance),
+};
+
+static struct ubus_object_type ps_object_type =
+	UBUS_OBJECT_TYPE("packet_steering", ps_methods);
+
+static struct ubus_object ps_object = {
+	.name = "packet_steering",
+	.type = &ps_object_type,
+	.methods = ps_methods,
+	.n_methods = ARRAY_SIZE(ps_methods),
+};
+
+static void
+ps_ubus_connect_cb(struct ubus_context *ctx)
+{
+	if (ubus_add_object(ctx, &ps_object))
+		ULOG_ERR("Failed to add ubus object\n");
+}
+
+static int
+usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"Options:\n"
+		"	-i <seconds>	Rebalance interval (default: %d)\n"
+		"	-t <pps>	Receive rate per device above which RPS is enabled (default: %d)\n"
+		"	-H <percent>	Load difference required to move an IRQ (default: %d)\n"
+		"\n", progname, PS_DEFAULT_INTERVAL, PS_DEFAULT_THRESHOLD,
+		PS_DEFAULT_HYSTERESIS);
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int ch;
+
+	while ((ch = getopt(argc, argv, "i:t:H:")) != -1) {
+		switch (ch) {
+		case 'i':
+			interval = atoi(optarg);
+			if (interval < 1)
+				interval = 1;
+			break;
+		case 't':
+			rps_threshold = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			hysteresis = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	ulog_open(ULOG_SYSLOG, LOG_DAEMON, "packet-steeringd");
+
+	ps_topology_init();
+
+	uloop_init();
+
+	conn.cb = ps_ubus_connect_cb;
+	ubus_auto_connect(&conn);
+
+	ps_timer_cb(&run_timer);
+	uloop_run();
+	uloop_done();
+
+	return 0;
+}
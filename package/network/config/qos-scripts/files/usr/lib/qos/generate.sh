@@ -228,6 +228,7 @@ qos_parse_config() {
 			}
 		;;
 		classgroup) append CG "$1";;
+		globals) config_get backend "$1" backend;;
 		classify|default|reclassify)
 			case "$TYPE" in
 				classify) var="ctrules";;
@@ -465,7 +466,98 @@ EOF
 	unset INSMOD
 }
 
+nft_add_rules() {
+	local chain="$1"
+	local rules="$2"
+
+	for rule in $rules; do
+		config_get TYPE "$rule" TYPE
+		config_get target "$rule" target
+		config_get target "$target" classnr
+		[ -z "$target" ] && continue
+		config_get options "$rule" options
+
+		line="$chain	$TYPE	$target"
+		for option in $options; do
+			config_get value "$rule" "$option"
+			[ -z "$value" ] && continue
+			case "$option" in
+				mark)
+					config_get class "${value##!}" classnr
+					[ -z "$class" ] && continue
+					case "$value" in
+						!*) value="!$class";;
+						*) value="$class";;
+					esac
+				;;
+			esac
+			line="$line	$option=$value"
+		done
+		echo "$line"
+	done
+}
+
+nft_cg() {
+	local cg="$1"
+	local marks ct
+	enum_classes "$cg"
+	ct="$(nft_add_rules "qos_${cg}_ct" "$ctrules")"
+	[ -n "$ct" ] && echo "$ct"
+	config_get classes "$cg" classes
+	for class in $classes; do
+		config_get mark "$class" classnr
+		[ -n "$mark" ] && append marks "$mark"
+	done
+	# nft can only set a mark to a constant under a mask, so the CONNMARK
+	# --restore-mark and --save-mark masks become one rule per class
+	echo "raw	qos_${cg}	ct mark & 0x0f == 0 meta mark set meta mark & 0xfffffff0"
+	for mark in $marks; do
+		echo "raw	qos_${cg}	ct mark & 0x0f == $mark meta mark set meta mark & 0xfffffff0 | $mark"
+	done
+	[ -n "$ct" ] && echo "raw	qos_${cg}	meta mark & 0x0f == 0 jump qos_${cg}_ct"
+	for class in $classes; do
+		config_get mark "$class" classnr
+		config_get maxsize "$class" maxsize
+		[ -z "$maxsize" -o -z "$mark" ] || \
+			echo "qos_${cg}	maxsize	$mark	maxsize=$maxsize"
+	done
+	nft_add_rules "qos_${cg}" "$rules"
+	# the low byte holds either nothing, a restored connection class or a
+	# packet class set in both nibbles
+	echo "raw	qos_${cg}	meta mark & 0xff == 0 ct mark set ct mark & 0xffffff00"
+	for mark in $marks; do
+		for mark in $(printf "0x%02x 0x%02x" $mark $((mark * 17))); do
+			echo "raw	qos_${cg}	meta mark & 0xff == $mark ct mark set ct mark & 0xffffff00 | $mark"
+		done
+	done
+	for iface in $INTERFACES; do
+		config_get classgroup "$iface" classgroup
+		config_get device "$iface" device
+		[ "$classgroup" = "$cg" ] && echo "dev	$device	qos_${cg}"
+	done
+}
+
+# Same classification as the iptables chains, as a single nftables table.
+# Port rules are compiled into verdict map lookups, see nftrules.awk.
+start_firewall_nft() {
+	local _dir=/usr/lib/qos
+	[ -e $_dir/nftrules.awk ] || _dir=.
+	echo 'cat > /var/run/qos.nft <<"EOF"'
+	for group in $CG; do
+		nft_cg $group
+	done | awk -v device="$device" -f $_dir/nftrules.awk
+	echo 'EOF'
+	# keep the current rules when nft rejects the new ones
+	echo 'nft -c -f /var/run/qos.nft || { logger -t qos "nft rejected /var/run/qos.nft"; exit 1; }'
+	stop_firewall
+	echo 'nft -f /var/run/qos.nft'
+}
+
 start_firewall() {
+	[ "$backend" = "nftables" ] && {
+		start_firewall_nft
+		return
+	}
 	add_insmod xt_multiport
 	add_insmod xt_connmark
 	stop_firewall
@@ -475,6 +567,9 @@ start_firewall() {
 }
 
 stop_firewall() {
+	# The nftables backend keeps everything in one table
+	[ -x /usr/sbin/nft ] && echo "nft delete table inet qos >&- 2>&-"
+
 	# Builds up a list of iptables commands to flush the qos_* chains,
 	# remove rules referring to them, then delete them
 
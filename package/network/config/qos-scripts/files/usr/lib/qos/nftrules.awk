@@ -0,0 +1,385 @@
+# Compiles the classification rules emitted by generate.sh into an nftables
+# ruleset. Runs of plain port rules are turned into verdict maps from
+# protocol and port to a per class chain setting the class mark, so that they
+# cost a single lookup per packet instead of one rule each.
+#
+# Input lines are tab separated:
+#   dev     <device> <chain>             interface dispatch
+#   raw     <chain>  <statement>         copied as is
+#   <chain> maxsize  <class> maxsize=<n>
+#   <chain> <type>   <class> <option>=<value>...
+BEGIN {
+	FS="\t"
+	n_chains = 0
+	n_devs = 0
+	n_maps = 0
+	rule_id = 0
+	group = ""
+
+	tos["minimize-delay"] = 16
+	tos["maximize-throughput"] = 8
+	tos["maximize-reliability"] = 4
+	tos["minimize-cost"] = 2
+	tos["normal-service"] = 0
+}
+
+function hex(v,    n, i, c) {
+	v = tolower(v)
+	if (v !~ /^0x/)
+		return v + 0
+	n = 0
+	for (i = 3; i <= length(v); i++) {
+		c = index("0123456789abcdef", substr(v, i, 1))
+		if (!c)
+			break
+		n = n * 16 + c - 1
+	}
+	return n
+}
+
+function chain_print(chain) {
+	print "\tchain " chain " {"
+	printf "%s", chains[chain]
+	print "\t}"
+	print ""
+}
+
+function chain_add(chain, stmt) {
+	if (!(chain in chains)) {
+		chain_list[++n_chains] = chain
+		chains[chain] = ""
+	}
+	chains[chain] = chains[chain] "\t\t" stmt "\n"
+}
+
+function nft_set(v,    n, a, i, s) {
+	gsub(/:/, "-", v)
+	n = split(v, a, ",")
+	if (n == 1)
+		return a[1]
+	s = a[1]
+	for (i = 2; i <= n; i++)
+		s = s ", " a[i]
+	return "{ " s " }"
+}
+
+function nft_range(v) {
+	gsub(/:/, "-", v)
+	if (v ~ /^-/)
+		return "<= " substr(v, 2)
+	if (v ~ /-$/)
+		return ">= " substr(v, 1, length(v) - 1)
+	return v
+}
+
+function neg(v) {
+	return (v ~ /^!/) ? "!= " substr(v, 2) : v
+}
+
+function dscp_val(v) {
+	v = tolower(v)
+	if (v == "be")
+		return "cs0"
+	return v
+}
+
+function tos_val(v,    inv) {
+	inv = (v ~ /^!/)
+	if (inv)
+		v = substr(v, 2)
+	v = tolower(v)
+	v = (v in tos) ? tos[v] : hex(v)
+	return (inv ? "!= " : "") int(v / 4)
+}
+
+# chain setting the low byte of the mark to the given class mark, shared by
+# the connection and packet chains of a class group
+function mark_chain(chain, mark,    name) {
+	sub(/_ct$/, "", chain)
+	name = chain "_set_" substr(mark, 3)
+	if (!(name in chains)) {
+		chain_add(name, "meta mark set meta mark & 0xffffff00 | " mark)
+		mark_chains[name] = 1
+	}
+	return name
+}
+
+function flush_group(    n, dirs, i, dir, name) {
+	if (group == "")
+		return
+	n = split("dport sport", dirs, " ")
+	for (i = 1; i <= n; i++) {
+		dir = dirs[i]
+		if (!(dir in g_elems))
+			continue
+		name = g_chain "_" (++n_maps)
+		maps = maps "\tmap " name " {\n" \
+			"\t\ttype inet_proto . inet_service : verdict\n" \
+			"\t\tflags interval\n" \
+			"\t\telements = { " g_elems[dir] " }\n" \
+			"\t}\n\n"
+		chain_add(g_chain, g_guard "meta l4proto . th " dir " vmap @" name)
+	}
+	group = ""
+	delete g_elems
+	delete iv_n
+	delete iv_lo
+	delete iv_hi
+	delete iv_rule
+}
+
+# returns 1 if [lo, hi] overlaps a port of an earlier rule in the group
+function overlaps(key, lo, hi, own,    i) {
+	for (i = 1; i <= iv_n[key]; i++) {
+		if (lo > iv_hi[key, i] || hi < iv_lo[key, i])
+			continue
+		if (own || iv_rule[key, i] != rule_id)
+			return 1
+	}
+	return 0
+}
+
+function map_ports(dirs, protos, ports, mark, check,    nd, d, np, p, n, a, i, r, lo, hi, key, di, pi) {
+	nd = split(dirs, d, " ")
+	np = split(protos, p, " ")
+	n = split(ports, a, ",")
+	for (i = 1; i <= n; i++) {
+		split(a[i], r, "[-:]")
+		lo = r[1] + 0
+		hi = (r[2] != "") ? r[2] + 0 : lo
+		for (di = 1; di <= nd; di++) {
+			for (pi = 1; pi <= np; pi++) {
+				key = d[di] SUBSEP p[pi]
+				if (check) {
+					if (overlaps(key, lo, hi, 0))
+						return 1
+					continue
+				}
+				# first match wins within a rule as well
+				if (overlaps(key, lo, hi, 1))
+					continue
+				iv_n[key]++
+				iv_lo[key, iv_n[key]] = lo
+				iv_hi[key, iv_n[key]] = hi
+				iv_rule[key, iv_n[key]] = rule_id
+				g_elems[d[di]] = g_elems[d[di]] (g_elems[d[di]] != "" ? ", " : "") \
+					p[pi] " . " (lo == hi ? lo : lo "-" hi) " : jump " mark_chain(g_chain, mark)
+			}
+		}
+	}
+	return 0
+}
+
+function add_map_rule(chain, key, guard, dirs, protos, ports, mark) {
+	if (group != key || map_ports(dirs, protos, ports, mark, 1)) {
+		flush_group()
+		group = key
+		g_chain = chain
+		g_guard = guard
+	}
+	map_ports(dirs, protos, ports, mark, 0)
+}
+
+$1 == "dev" {
+	if (!($2 in devs)) {
+		devs[$2] = $3
+		dev_list[++n_devs] = $2
+	}
+	next
+}
+
+$1 == "raw" {
+	flush_group()
+	chain_add($2, $3)
+	next
+}
+
+$2 == "maxsize" {
+	flush_group()
+	split($4, kv, "=")
+	chain_add($1, "meta mark & 0x0f == " $3 " meta length >= " kv[2] " meta mark set meta mark & 0xffffff00")
+	next
+}
+
+{
+	chain = $1
+	type = $2
+	mark = sprintf("0x%02x", $3 * 17)
+	pkt = (type != "classify")
+	rule_id++
+
+	delete opt
+	port_opt = ""
+	action = ""
+	for (i = 4; i <= NF; i++) {
+		eq = index($i, "=")
+		key = substr($i, 1, eq - 1)
+		val = substr($i, eq + 1)
+		if (key in opt)
+			continue
+		# only one port match per rule, as with iptables
+		if (key ~ /^(ports|srcports|dstports|portrange)$/) {
+			if (port_opt != "")
+				continue
+			port_opt = key
+		}
+		if (pkt && (key == "DSCP" || key == "TOS"))
+			action = key
+		opt[key] = val
+	}
+
+	guard = ""
+	if (type == "classify")
+		guard = "meta mark & 0x0f == 0 "
+	else if (type == "default")
+		guard = "meta mark & 0xf0 == 0 "
+
+	proto = opt["proto"]
+	if (port_opt != "" && proto !~ /^(|tcp|udp)$/)
+		next
+	if (pkt && ("tcpflags" in opt) && proto != "tcp")
+		next
+	protos = proto
+	if (proto == "" && port_opt != "")
+		protos = "tcp udp"
+
+	# plain port rules go into a map lookup
+	simple = (port_opt != "" && port_opt != "portrange" && action == "")
+	for (key in opt) {
+		if (key ~ /^(proto|ports|srcports|dstports|comment|target)$/)
+			continue
+		if (!pkt && key ~ /^(pktsize|limit|tcpflags|mark|DSCP|TOS)$/)
+			continue
+		if (key ~ /^(srchost|dsthost|connbytes|tos|dscp|direction|srciface|pktsize|limit|tcpflags|mark|DSCP|TOS)$/)
+			simple = 0
+	}
+
+	if (simple) {
+		dirs = (port_opt == "ports") ? "dport sport" : (port_opt == "srcports") ? "sport" : "dport"
+		add_map_rule(chain, chain SUBSEP type, guard, dirs, protos, opt[port_opt], mark)
+		next
+	}
+
+	flush_group()
+
+	fam = ""
+	if ("srchost" in opt)
+		fam = (opt["srchost"] ~ /:/) ? "ip6" : "ip"
+	if ("dsthost" in opt) {
+		f = (opt["dsthost"] ~ /:/) ? "ip6" : "ip"
+		if (fam != "" && fam != f)
+			next
+		fam = f
+	}
+	fams = fam
+	if (fam == "" && (("tos" in opt) || ("dscp" in opt) || action != ""))
+		fams = "ip ip6"
+	if (fams == "")
+		fams = "-"
+
+	ports[1] = ""
+	n_ports = 1
+	if (port_opt == "ports") {
+		ports[1] = "th dport " nft_set(opt[port_opt])
+		ports[2] = "th sport " nft_set(opt[port_opt])
+		n_ports = 2
+	} else if (port_opt == "srcports") {
+		ports[1] = "th sport " nft_set(opt[port_opt])
+	} else if (port_opt == "dstports") {
+		ports[1] = "th dport " nft_set(opt[port_opt])
+	} else if (port_opt == "portrange") {
+		ports[1] = "th sport " nft_set(opt[port_opt]) " th dport " nft_set(opt[port_opt])
+	}
+
+	nf = split(fams, fl, " ")
+	np = split(protos == "" ? "-" : protos, pl, " ")
+	for (fi = 1; fi <= nf; fi++) {
+		for (pi = 1; pi <= np; pi++) {
+			for (qi = 1; qi <= n_ports; qi++) {
+				f = fl[fi]
+				m = guard
+				if (pl[pi] != "-")
+					m = m "meta l4proto " pl[pi] " "
+				if ("srchost" in opt)
+					m = m f " saddr " opt["srchost"] " "
+				if ("dsthost" in opt)
+					m = m f " daddr " opt["dsthost"] " "
+				if (ports[qi] != "")
+					m = m ports[qi] " "
+				if ("connbytes" in opt)
+					m = m "ct bytes " nft_range(opt["connbytes"]) " "
+				if ("tos" in opt)
+					m = m f " dscp " tos_val(opt["tos"]) " "
+				if ("dscp" in opt)
+					m = m f " dscp " neg(dscp_val(opt["dscp"])) " "
+				if (opt["direction"] == "out")
+					m = m "oifname \"" device "\" "
+				else if (opt["direction"] == "in")
+					m = m "iifname \"" device "\" "
+				if ("srciface" in opt)
+					m = m "iifname \"" opt["srciface"] "\" "
+				if (pkt && ("pktsize" in opt))
+					m = m "meta length " nft_range(opt["pktsize"]) " "
+				if (pkt && ("limit" in opt)) {
+					split(opt["limit"], lim, "/")
+					unit = substr(lim[2], 1, 1)
+					unit = (unit == "m") ? "minute" : (unit == "h") ? "hour" : (unit == "d") ? "day" : "second"
+					m = m "limit rate " lim[1] "/" unit " "
+				}
+				if (pkt && ("tcpflags" in opt)) {
+					flags = tolower(opt["tcpflags"])
+					gsub(/,/, " | ", flags)
+					if (flags == "none")
+						flags = "0x0"
+					m = m "tcp flags & (fin | syn | rst | psh | ack | urg) == " flags " "
+				}
+				if (pkt && ("mark" in opt))
+					m = m "meta mark & 0x0f " neg(opt["mark"]) " "
+
+				if (action == "DSCP")
+					m = m f " dscp set " dscp_val(opt["DSCP"])
+				else if (action == "TOS")
+					m = m f " dscp set " tos_val(opt["TOS"] != "" ? opt["TOS"] : "normal-service")
+				else
+					m = m "meta mark set meta mark & 0xffffff00 | " mark
+
+				if (opt["comment"] != "") {
+					c = opt["comment"]
+					gsub(/"/, "", c)
+					m = m " comment \"" c "\""
+				}
+				chain_add(chain, m)
+			}
+		}
+	}
+}
+
+END {
+	flush_group()
+
+	# the maps jump to the mark chains, and the rules look up the maps
+	print "table inet qos {"
+	for (i = 1; i <= n_chains; i++)
+		if (chain_list[i] in mark_chains)
+			chain_print(chain_list[i])
+	printf "%s", maps
+	for (i = 1; i <= n_chains; i++)
+		if (!(chain_list[i] in mark_chains))
+			chain_print(chain_list[i])
+
+	vmap = ""
+	for (i = 1; i <= n_devs; i++)
+		vmap = vmap (i > 1 ? ", " : "") "\"" dev_list[i] "\" : jump " devs[dev_list[i]]
+
+	split("forward output", hooks, " ")
+	for (i = 1; i <= 2; i++) {
+		print "\tchain " hooks[i] " {"
+		print "\t\ttype filter hook " hooks[i] " priority mangle; policy accept;"
+		if (vmap != "")
+			print "\t\toifname vmap { " vmap " }"
+		print "\t}"
+		if (i == 1)
+			print ""
+	}
+	print "}"
+}
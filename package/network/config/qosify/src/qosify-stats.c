@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * qosify-stats - export CAKE qdisc statistics via ubus
+ *
+ * Dumps the root qdiscs over rtnetlink on every call and reports the
+ * counters of the CAKE instances set up by qosify, the egress instance on
+ * <dev> and the ingress instance on ifb-<dev>. Each CAKE tin corresponds
+ * to a group of DSCP classes of the configured diffserv mode.
+ */
+#include <sys/socket.h>
+#include <linux/gen_stats.h>
+#include <linux/netlink.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+#include <errno.h>
+#include <net/if.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libubox/uloop.h>
+#include <libubox/blobmsg.h>
+#include <libubus.h>
+
+#define QOSIFY_IFB_PREFIX	"ifb-"
+
+static struct ubus_auto_conn conn;
+static struct blob_buf b;
+static uint32_t nl_seq;
+static int nl_fd = -1;
+
+static const char * const diffserv3_tins[] = { "Bulk", "Best Effort", "Voice" };
+static const char * const diffserv4_tins[] = { "Bulk", "Best Effort", "Video", "Voice" };
+
+static const struct {
+	const char *name;
+	int attr;
+} tin_stats[] = {
+	{ "sent_packets", TCA_CAKE_TIN_STATS_SENT_PACKETS },
+	{ "sent_bytes", TCA_CAKE_TIN_STATS_SENT_BYTES64 },
+	{ "dropped_packets", TCA_CAKE_TIN_STATS_DROPPED_PACKETS },
+	{ "dropped_bytes", TCA_CAKE_TIN_STATS_DROPPED_BYTES64 },
+	{ "ack_drops", TCA_CAKE_TIN_STATS_ACKS_DROPPED_PACKETS },
+	{ "ecn_marked_packets", TCA_CAKE_TIN_STATS_ECN_MARKED_PACKETS },
+	{ "backlog_packets", TCA_CAKE_TIN_STATS_BACKLOG_PACKETS },
+	{ "backlog_bytes", TCA_CAKE_TIN_STATS_BACKLOG_BYTES },
+	{ "threshold_rate", TCA_CAKE_TIN_STATS_THRESHOLD_RATE64 },
+	{ "peak_delay_us", TCA_CAKE_TIN_STATS_PEAK_DELAY_US },
+	{ "avg_delay_us", TCA_CAKE_TIN_STATS_AVG_DELAY_US },
+	{ "base_delay_us", TCA_CAKE_TIN_STATS_BASE_DELAY_US },
+	{ "sparse_flows", TCA_CAKE_TIN_STATS_SPARSE_FLOWS },
+	{ "bulk_flows", TCA_CAKE_TIN_STATS_BULK_FLOWS },
+	{ "unresponsive_flows", TCA_CAKE_TIN_STATS_UNRESPONSIVE_FLOWS },
+	{ "way_indirect_hits", TCA_CAKE_TIN_STATS_WAY_INDIRECT_HITS },
+	{ "way_misses", TCA_CAKE_TIN_STATS_WAY_MISSES },
+	{ "way_collisions", TCA_CAKE_TIN_STATS_WAY_COLLISIONS },
+};
+
+static void
+parse_attrs(struct rtattr **tb, int max, struct rtattr *rta, int len)
+{
+	memset(tb, 0, (max + 1) * sizeof(*tb));
+	for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		unsigned short type = rta->rta_type & NLA_TYPE_MASK;
+
+		if (type <= max)
+			tb[type] = rta;
+	}
+}
+
+static void
+parse_nested(struct rtattr **tb, int max, struct rtattr *rta)
+{
+	parse_attrs(tb, max, RTA_DATA(rta), RTA_PAYLOAD(rta));
+}
+
+/* counters are u32 or u64 depending on the attribute */
+static uint64_t
+rta_get_uint(struct rtattr *rta)
+{
+	uint64_t val64;
+	uint32_t val32;
+
+	if (RTA_PAYLOAD(rta) >= sizeof(val64)) {
+		memcpy(&val64, RTA_DATA(rta), sizeof(val64));
+		return val64;
+	}
+
+	if (RTA_PAYLOAD(rta) >= sizeof(val32)) {
+		memcpy(&val32, RTA_DATA(rta), sizeof(val32));
+		return val32;
+	}
+
+	return 0;
+}
+
+static const char *
+tin_name(int mode, unsigned int tin, char *buf, size_t len)
+{
+	if (mode == CAKE_DIFFSERV_DIFFSERV3 && tin < ARRAY_SIZE(diffserv3_tins))
+		return diffserv3_tins[tin];
+
+	if (mode == CAKE_DIFFSERV_DIFFSERV4 && tin < ARRAY_SIZE(diffserv4_tins))
+		return diffserv4_tins[tin];
+
+	if (mode == CAKE_DIFFSERV_BESTEFFORT)
+		return "Best Effort";
+
+	snprintf(buf, len, "Tin %u", tin);
+
+	return buf;
+}
+
+static const char *
+diffserv_name(int mode)
+{
+	switch (mode) {
+	case CAKE_DIFFSERV_DIFFSERV3:
+		return "diffserv3";
+	case CAKE_DIFFSERV_DIFFSERV4:
+		return "diffserv4";
+	case CAKE_DIFFSERV_DIFFSERV8:
+		return "diffserv8";
+	case CAKE_DIFFSERV_BESTEFFORT:
+		return "besteffort";
+	case CAKE_DIFFSERV_PRECEDENCE:
+		return "precedence";
+	default:
+		return "unknown";
+	}
+}
+
+static void
+add_tins(struct rtattr *attr, int mode)
+{
+	struct rtattr *tb[TCA_CAKE_TIN_STATS_MAX + 1];
+	struct rtattr *rta;
+	char buf[16];
+	unsigned int i;
+	void *c, *t;
+	int len;
+
+	c = blobmsg_open_table(&b, "tins");
+
+	len = RTA_PAYLOAD(attr);
+	for (rta = RTA_DATA(attr); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		/* nested tins are numbered from 1 */
+		int tin = (rta->rta_type & NLA_TYPE_MASK) - 1;
+
+		if (tin < 0)
+			continue;
+
+		parse_nested(tb, TCA_CAKE_TIN_STATS_MAX, rta);
+
+		t = blobmsg_open_table(&b, tin_name(mode, tin, buf, sizeof(buf)));
+		for (i = 0; i < ARRAY_SIZE(tin_stats); i++)
+			if (tb[tin_stats[i].attr])
+				blobmsg_add_u64(&b, tin_stats[i].name,
+						rta_get_uint(tb[tin_stats[i].attr]));
+		blobmsg_close_table(&b, t);
+	}
+
+	blobmsg_close_table(&b, c);
+}
+
+static void
+add_qdisc(struct rtattr **tca)
+{
+	struct rtattr *opts[TCA_CAKE_MAX + 1];
+	struct rtattr *stats[TCA_STATS_MAX + 1];
+	struct rtattr *app[TCA_CAKE_STATS_MAX + 1];
+	int mode = CAKE_DIFFSERV_DIFFSERV3;
+
+	if (tca[TCA_OPTIONS]) {
+		parse_nested(opts, TCA_CAKE_MAX, tca[TCA_OPTIONS]);
+		if (opts[TCA_CAKE_DIFFSERV_MODE])
+			mode = rta_get_uint(opts[TCA_CAKE_DIFFSERV_MODE]);
+		if (opts[TCA_CAKE_BASE_RATE64])
+			blobmsg_add_u64(&b, "bandwidth", rta_get_uint(opts[TCA_CAKE_BASE_RATE64]));
+	}
+	blobmsg_add_string(&b, "diffserv", diffserv_name(mode));
+
+	if (!tca[TCA_STATS2])
+		return;
+
+	parse_nested(stats, TCA_STATS_MAX, tca[TCA_STATS2]);
+
+	if (stats[TCA_STATS_BASIC]) {
+		struct gnet_stats_basic basic = {};
+
+		if (RTA_PAYLOAD(stats[TCA_STATS_BASIC]) >= sizeof(basic))
+			memcpy(&basic, RTA_DATA(stats[TCA_STATS_BASIC]), sizeof(basic));
+		blobmsg_add_u64(&b, "bytes", basic.bytes);
+		blobmsg_add_u64(&b, "packets", basic.packets);
+	}
+
+	if (stats[TCA_STATS_QUEUE]) {
+		struct gnet_stats_queue queue = {};
+
+		if (RTA_PAYLOAD(stats[TCA_STATS_QUEUE]) >= sizeof(queue))
+			memcpy(&queue, RTA_DATA(stats[TCA_STATS_QUEUE]), sizeof(queue));
+		blobmsg_add_u64(&b, "drops", queue.drops);
+		blobmsg_add_u64(&b, "overlimits", queue.overlimits);
+		blobmsg_add_u64(&b, "requeues", queue.requeues);
+		blobmsg_add_u64(&b, "backlog", queue.backlog);
+		blobmsg_add_u64(&b, "qlen", queue.qlen);
+	}
+
+	if (!stats[TCA_STATS_APP])
+		return;
+
+	parse_nested(app, TCA_CAKE_STATS_MAX, stats[TCA_STATS_APP]);
+
+	if (app[TCA_CAKE_STATS_CAPACITY_ESTIMATE64])
+		blobmsg_add_u64(&b, "capacity_estimate",
+				rta_get_uint(app[TCA_CAKE_STATS_CAPACITY_ESTIMATE64]));
+	if (app[TCA_CAKE_STATS_MEMORY_USED])
+		blobmsg_add_u64(&b, "memory_used",
+				rta_get_uint(app[TCA_CAKE_STATS_MEMORY_USED]));
+	if (app[TCA_CAKE_STATS_TIN_STATS])
+		add_tins(app[TCA_CAKE_STATS_TIN_STATS], mode);
+}
+
+static void
+add_device(struct tcmsg *tcm, struct rtattr **tca, const char *filter)
+{
+	char ifname[IF_NAMESIZE];
+	const char *dev = ifname;
+	const char *dir = "egress";
+	void *c;
+
+	if (tcm->tcm_parent != TC_H_ROOT || !tca[TCA_KIND] ||
+	    strcmp(RTA_DATA(tca[TCA_KIND]), "cake") != 0)
+		return;
+
+	if (!if_indextoname(tcm->tcm_ifindex, ifname))
+		return;
+
+	if (!strncmp(ifname, QOSIFY_IFB_PREFIX, strlen(QOSIFY_IFB_PREFIX))) {
+		dev += strlen(QOSIFY_IFB_PREFIX);
+		dir = "ingress";
+	}
+
+	if (filter && strcmp(filter, dev) != 0)
+		return;
+
+	c = blobmsg_open_table(&b, ifname);
+	blobmsg_add_string(&b, "device", dev);
+	blobmsg_add_string(&b, "direction", dir);
+	add_qdisc(tca);
+	blobmsg_close_table(&b, c);
+}
+
+static int
+nl_dump_qdiscs(const char *filter)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct tcmsg tcm;
+	} req = {
+		.nh = {
+			.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg)),
+			.nlmsg_type = RTM_GETQDISC,
+			.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+			.nlmsg_seq = ++nl_seq,
+		},
+	};
+	static char buf[32768];
+	struct nlmsghdr *nh;
+	int len;
+
+	if (send(nl_fd, &req, req.nh.nlmsg_len, 0) < 0)
+		return -1;
+
+	while (1) {
+		len = recv(nl_fd, buf, sizeof(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		for (nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+			struct rtattr *tca[TCA_MAX + 1];
+			struct tcmsg *tcm;
+
+			/* replies to an earlier, interrupted dump */
+			if (nh->nlmsg_seq != nl_seq)
+				continue;
+
+			if (nh->nlmsg_type == NLMSG_DONE)
+				return 0;
+
+			if (nh->nlmsg_type == NLMSG_ERROR)
+				return -1;
+
+			if (nh->nlmsg_type != RTM_NEWQDISC)
+				continue;
+
+			tcm = NLMSG_DATA(nh);
+			parse_attrs(tca, TCA_MAX, TCA_RTA(tcm), TCA_PAYLOAD(nh));
+			add_device(tcm, tca, filter);
+		}
+	}
+}
+
+enum {
+	STATS_DEVICE,
+	__STATS_MAX
+};
+
+static const struct blobmsg_policy stats_policy[__STATS_MAX] = {
+	[STATS_DEVICE] = { "device", BLOBMSG_TYPE_STRING },
+};
+
+static int
+qosify_stats_get(struct ubus_context *ctx, struct ubus_object *obj,
+		 struct ubus_request_data *req, const char *method,
+		 struct blob_attr *msg)
+{
+	struct blob_attr *tb[__STATS_MAX];
+	const char *filter = NULL;
+	void *c;
+
+	blobmsg_parse(stats_policy, __STATS_MAX, tb, blobmsg_data(msg), blobmsg_len(msg));
+	if (tb[STATS_DEVICE])
+		filter = blobmsg_get_string(tb[STATS_DEVICE]);
+
+	blob_buf_init(&b, 0);
+	c = blobmsg_open_table(&b, "devices");
+	if (nl_dump_qdiscs(filter))
+		return UBUS_STATUS_UNKNOWN_ERROR;
+	blobmsg_close_table(&b, c);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
+static const struct ubus_method qosify_stats_methods[] = {
+	UBUS_METHOD("get", qosify_stats_get, stats_policy),
+};
+
+static struct ubus_object_type qosify_stats_object_type =
+	UBUS_OBJECT_TYPE("qosify_stats", qosify_stats_methods);
+
+static struct ubus_object qosify_stats_object = {
+	.name = "qosify.stats",
+	.type = &qosify_stats_object_type,
+	.methods = qosify_stats_methods,
+	.n_methods = ARRAY_SIZE(qosify_stats_methods),
+};
+
+static void
+qosify_stats_connect_cb(struct ubus_context *ctx)
+{
+	ubus_add_object(ctx, &qosify_stats_object);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_nl sa = {
+		.nl_family = AF_NETLINK,
+	};
+
+	nl_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (nl_fd < 0 || bind(nl_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		perror("netlink");
+		return 1;
+	}
+
+	uloop_init();
+	conn.cb = qosify_stats_connect_cb;
+	ubus_auto_connect(&conn);
+	uloop_run();
+	uloop_done();
+
+	close(nl_fd);
+
+	return 0;
+}
@@ -20,6 +20,46 @@
 	init_proto "$@"
 }
 
+# Port-restricted SNAT as one rule per protocol picking one of the port
+# sets by a numgen lookup in a map, instead of one firewall rule per port
+# set and protocol. Connections are spread round-robin across the port
+# sets rather than filling each set before moving on to the next one.
+# Runs ahead of the firewall's own srcnat chain. The port mapping needs an
+# exact transport protocol match, so each protocol gets its own rule, and
+# the ruleset is checked before it is loaded so that a rejected ruleset
+# falls back to the per port set firewall rules.
+proto_map_nft_snat() {
+	local cfg="$1"
+	local link="$2"
+	local k="$3"
+	local map proto rules=""
+
+	command -v nft >/dev/null || return 1
+
+	map="numgen inc mod $(eval "echo \$RULE_${k}_PORTMAP_SIZE") map { $(eval "echo \$RULE_${k}_PORTMAP") }"
+	for proto in icmp tcp udp; do
+		rules="$rules
+			oifname \"$link\" meta l4proto $proto snat ip to $map"
+	done
+
+	local ruleset="table ip map_$cfg {
+		chain srcnat {
+			type nat hook postrouting priority srcnat - 1; policy accept;$rules
+		}
+	}"
+
+	echo "$ruleset" | nft -c -f - || {
+		logger -t map "$cfg: nftables rejected the port set map, using per port set rules"
+		return 1
+	}
+
+	nft -f - <<-EOF
+		table ip map_$cfg
+		delete table ip map_$cfg
+		$ruleset
+	EOF
+}
+
 proto_map_setup() {
 	local cfg="$1"
 	local iface="$2"
@@ -139,6 +179,8 @@ proto_map_setup() {
 	      json_add_string family inet
 	      json_add_string snat_ip $(eval "echo \$RULE_${k}_IPV4ADDR")
 	    json_close_object
+	  elif [ -n "$(eval "echo \$RULE_${k}_PORTMAP")" ] && proto_map_nft_snat "$cfg" "$link" "$k"; then
+	    :
 	  else
 	    for portset in $(eval "echo \$RULE_${k}_PORTSETS"); do
               for proto in icmp tcp udp; do
@@ -213,6 +255,8 @@ proto_map_teardown() {
 		"map-t") [ -f "/proc/net/nat46/control" ] && echo del $link > /proc/net/nat46/control ;;
 	esac
 
+	command -v nft >/dev/null && nft delete table ip "map_$cfg" 2>/dev/null
+
 	rm -f /tmp/map-$cfg.rules
 }
 
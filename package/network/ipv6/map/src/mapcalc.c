@@ -168,6 +168,19 @@ enum {
 	OPT_MAX
 };
 
+/* k-th contiguous port range of the port set, false if it is empty */
+static bool portset_range(int k, int offset, int psid, int psidlen, int *start, int *end)
+{
+	*start = (k << (16 - offset)) | (psid >> offset);
+	*end = *start + (1 << (16 - offset - psidlen)) - 1;
+
+	if (*start == 0)
+		*start = 1;
+
+	return *start <= *end;
+}
+
+
 static char *const token[] = {
 	[OPT_TYPE] = "type",
 	[OPT_FMR] = "fmr",
@@ -392,18 +405,29 @@ int main(int argc, char *argv[])
 
 
 		if (psidlen > 0 && psid >= 0) {
-			printf("RULE_%d_PORTSETS='", rulecnt);
-			for (int k = (offset) ? 1 : 0; k < (1 << offset); ++k) {
-				int start = (k << (16 - offset)) | (psid >> offset);
-				int end = start + (1 << (16 - offset - psidlen)) - 1;
+			int start, end, n = 0;
 
-				if (start == 0)
-					start = 1;
-
-				if (start <= end)
+			printf("RULE_%d_PORTSETS='", rulecnt);
+			for (int k = (offset) ? 1 : 0; k < (1 << offset); ++k)
+				if (portset_range(k, offset, psid, psidlen, &start, &end))
 					printf("%d-%d ", start, end);
-			}
 			printf("'\n");
+
+			/* the same port sets as nftables map elements, keyed by
+			 * index so that a single snat can pick one by numgen */
+			if (ipv4addr.s_addr) {
+				printf("RULE_%d_PORTMAP='", rulecnt);
+				for (int k = (offset) ? 1 : 0; k < (1 << offset); ++k) {
+					if (!portset_range(k, offset, psid, psidlen, &start, &end))
+						continue;
+
+					printf("%s%d : %s . %d-%d", n ? ", " : "",
+							n, ipv4addrbuf, start, end);
+					n++;
+				}
+				printf("'\n");
+				printf("RULE_%d_PORTMAP_SIZE=%d\n", rulecnt, n);
+			}
 		}
 
 		if (dmr)
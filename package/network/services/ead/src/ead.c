@@ -12,9 +12,12 @@
  * GNU General Public License for more details.
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/time.h>
-#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -22,28 +25,28 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <signal.h>
-#include <pcap.h>
-#include <pcap-bpf.h>
+#include <arpa/inet.h>
 #include <t_pwd.h>
 #include <t_read.h>
 #include <t_sha.h>
 #include <t_defines.h>
 #include <t_server.h>
 #include <net/if.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <libubox/uloop.h>
 
-#include "list.h"
 #include "ead.h"
 #include "ead-pcap.h"
 #include "ead-crypt.h"
-#include "libbridge.h"
 
 #include "filter.c"
 
-#ifdef linux
-#include <linux/if_packet.h>
-#endif
-
 #define PASSWD_FILE	"/etc/passwd"
 
 #ifndef DEFAULT_IFNAME
@@ -67,90 +70,86 @@
 #define DEBUG(n, format, ...) do {} while(0)
 #endif
 
+/*
+ * All interfaces are served by a single process. Each -d interface has an
+ * instance holding its own authentication session, requests are matched to
+ * instances by the interface they arrived on: the bridge an interface is a
+ * port of, or the interface itself. Replies go out on the port.
+ */
 struct ead_instance {
 	struct list_head list;
 	char ifname[16];
-	int pid;
+	int ifindex;
+	int rx_ifindex;
 	char id;
 	char bridge[16];
-	bool br_check;
+
+	/* session */
+	int state;
+	char username[32];
+	char password[MAXPARAMLEN];
+	unsigned char abuf[MAXPARAMLEN + 1];
+	unsigned char pwbuf[MAXPARAMLEN];
+	unsigned char saltbuf[MAXSALTLEN];
+	unsigned char pw_saltbuf[MAXSALTLEN];
+	struct t_pwent tpe;
+	struct t_confent *tce;
+	struct t_server *ts;
+	struct t_num A, *B;
+	unsigned char *skey;
+	struct ead_crypt *crypt;
+
+	/* running EAD_CMD_NORMAL command, output is streamed to the client */
+	struct uloop_process cmd_proc;
+	struct uloop_fd cmd_fd;
+	struct uloop_timeout cmd_timer;
+	struct ead_packet cmd_pkt;
+	time_t cmd_deadline;
 };
 
 static char ethmac[6] = "\x00\x13\x37\x00\x00\x00"; /* last 3 bytes will be randomized */
-static pcap_t *pcap_fp = NULL;
-static pcap_t *pcap_fp_rx = NULL;
 static char pktbuf_b[PCAP_MRU];
 static struct ead_packet *pktbuf = (struct ead_packet *)pktbuf_b;
+static char rxbuf[PCAP_MRU];
 static u16_t nid = 0xffff; /* node id */
-static char username[32] = "";
-static int state = EAD_TYPE_SET_USERNAME;
 static const char *passwd_file = PASSWD_FILE;
-static const char password[MAXPARAMLEN];
-static bool child_pending = false;
 
-static unsigned char abuf[MAXPARAMLEN + 1];
-static unsigned char pwbuf[MAXPARAMLEN];
-static unsigned char saltbuf[MAXSALTLEN];
-static unsigned char pw_saltbuf[MAXSALTLEN];
 static struct list_head instances;
 static const char *dev_name = DEFAULT_DEVNAME;
-static bool nonfork = false;
-static struct ead_instance *instance = NULL;
-
-static struct t_pwent tpe = {
-	.name = username,
-	.index = 1,
-	.password.data = pwbuf,
-	.password.len = 0,
-	.salt.data = saltbuf,
-	.salt.len = 0,
-};
-struct t_confent *tce = NULL;
-static struct t_server *ts = NULL;
-static struct t_num A, *B = NULL;
-unsigned char *skey;
+
+static struct uloop_fd pkt_fd = { .fd = -1 };
+static struct uloop_fd nl_fd = { .fd = -1 };
 
 static void
-set_recv_type(pcap_t *p, bool rx)
+set_recv_type(int fd)
 {
 #ifdef PACKET_RECV_TYPE
-	struct sockaddr_ll sll;
-	struct ifreq ifr;
-	int mask;
-	int fd;
-
-	fd = pcap_get_selectable_fd(p);
-	if (fd < 0)
-		return;
-
-	if (rx)
-		mask = 1 << PACKET_BROADCAST;
-	else
-		mask = 0;
+	int mask = 1 << PACKET_BROADCAST;
 
 	setsockopt(fd, SOL_PACKET, PACKET_RECV_TYPE, &mask, sizeof(mask));
 #endif
 }
 
-
-static pcap_t *
-ead_open_pcap(const char *ifname, char *errbuf, bool rx)
+/* one socket for all interfaces, the filter passes EAD requests only */
+static int
+ead_open_socket(void)
 {
-	pcap_t *p;
+	int fd, size = 10 * PCAP_MRU;
 
-	p = pcap_create(ifname, errbuf);
-	if (p == NULL)
-		goto out;
+	fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		    htons(ETH_P_IP));
+	if (fd < 0)
+		return -1;
 
-	pcap_set_snaplen(p, PCAP_MRU);
-	pcap_set_promisc(p, rx);
-	pcap_set_timeout(p, PCAP_TIMEOUT);
-	pcap_set_protocol_linux(p, (rx ? htons(ETH_P_IP) : 0));
-	pcap_set_buffer_size(p, (rx ? 10 : 1) * PCAP_MRU);
-	pcap_activate(p);
-	set_recv_type(p, rx);
-out:
-	return p;
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &pktfilter, sizeof(pktfilter)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	set_recv_type(fd);
+
+	return fd;
 }
 
 static void
@@ -168,13 +167,13 @@ get_random_bytes(void *ptr, int len)
 }
 
 static bool
-prepare_password(void)
+prepare_password(struct ead_instance *in)
 {
 	static char lbuf[1024];
 	unsigned char dig[SHA_DIGESTSIZE];
 	BigInteger x, v, n, g;
 	SHA1_CTX ctxt;
-	int ulen = strlen(username);
+	int ulen = strlen(in->username);
 	FILE *f;
 
 	lbuf[sizeof(lbuf) - 1] = 0;
@@ -186,7 +185,7 @@ prepare_password(void)
 	while (fgets(lbuf, sizeof(lbuf) - 1, f) != NULL) {
 		char *str, *s2;
 
-		if (strncmp(lbuf, username, ulen) != 0)
+		if (strncmp(lbuf, in->username, ulen) != 0)
 			continue;
 
 		if (lbuf[ulen] != ':')
@@ -204,8 +203,8 @@ prepare_password(void)
 		if (s2 - str >= MAXSALTLEN)
 			continue;
 
-		strncpy((char *) pw_saltbuf, str, s2 - str);
-		pw_saltbuf[s2 - str] = 0;
+		strncpy((char *) in->pw_saltbuf, str, s2 - str);
+		in->pw_saltbuf[s2 - str] = 0;
 
 		s2 = strchr(s2, ':');
 		if (!s2)
@@ -215,7 +214,7 @@ prepare_password(void)
 		if (s2 - str >= MAXPARAMLEN)
 			continue;
 
-		strncpy((char *)password, str, MAXPARAMLEN);
+		strncpy(in->password, str, MAXPARAMLEN);
 		fclose(f);
 		goto hash_password;
 	}
@@ -225,25 +224,25 @@ prepare_password(void)
 	return false;
 
 hash_password:
-	tce = gettcid(tpe.index);
+	in->tce = gettcid(in->tpe.index);
 	do {
-		t_random(tpe.password.data, SALTLEN);
-	} while (memcmp(saltbuf, (char *)dig, sizeof(saltbuf)) == 0);
-	if (saltbuf[0] == 0)
-		saltbuf[0] = 0xff;
+		t_random(in->tpe.password.data, SALTLEN);
+	} while (memcmp(in->saltbuf, (char *)dig, sizeof(in->saltbuf)) == 0);
+	if (in->saltbuf[0] == 0)
+		in->saltbuf[0] = 0xff;
 
-	n = BigIntegerFromBytes(tce->modulus.data, tce->modulus.len);
-	g = BigIntegerFromBytes(tce->generator.data, tce->generator.len);
+	n = BigIntegerFromBytes(in->tce->modulus.data, in->tce->modulus.len);
+	g = BigIntegerFromBytes(in->tce->generator.data, in->tce->generator.len);
 	v = BigIntegerFromInt(0);
 
 	SHA1Init(&ctxt);
-	SHA1Update(&ctxt, (unsigned char *) username, strlen(username));
+	SHA1Update(&ctxt, (unsigned char *) in->username, strlen(in->username));
 	SHA1Update(&ctxt, (unsigned char *) ":", 1);
-	SHA1Update(&ctxt, (unsigned char *) password, strlen(password));
+	SHA1Update(&ctxt, (unsigned char *) in->password, strlen(in->password));
 	SHA1Final(dig, &ctxt);
 
 	SHA1Init(&ctxt);
-	SHA1Update(&ctxt, saltbuf, tpe.salt.len);
+	SHA1Update(&ctxt, in->saltbuf, in->tpe.salt.len);
 	SHA1Update(&ctxt, dig, sizeof(dig));
 	SHA1Final(dig, &ctxt);
 
@@ -251,7 +250,7 @@ hash_password:
 	x = BigIntegerFromBytes(dig, sizeof(dig));
 
 	BigIntegerModExp(v, g, x, n);
-	tpe.password.len = BigIntegerToBytes(v, (unsigned char *)pwbuf);
+	in->tpe.password.len = BigIntegerToBytes(v, (unsigned char *)in->pwbuf);
 
 	BigIntegerFree(v);
 	BigIntegerFree(x);
@@ -292,10 +291,18 @@ chksum(u16_t sum, const u8_t *data, u16_t len)
 }
 
 static void
-ead_send_packet_clone(struct ead_packet *pkt)
+ead_send_packet_clone(struct ead_instance *in, struct ead_packet *pkt)
 {
+	struct sockaddr_ll sll = {
+		.sll_family = AF_PACKET,
+		.sll_ifindex = in->ifindex,
+		.sll_halen = 6,
+	};
 	u16_t len, sum;
 
+	if (!in->ifindex)
+		return;
+
 	memcpy(pktbuf, pkt, offsetof(struct ead_packet, msg));
 	memcpy(pktbuf->eh.ether_shost, ethmac, 6);
 	memcpy(pktbuf->eh.ether_dhost, pkt->eh.ether_shost, 6);
@@ -328,51 +335,54 @@ ead_send_packet_clone(struct ead_packet *pkt)
 	if (sum == 0)
 		sum = 0xffff;
 	pktbuf->udpchksum = htons(~sum);
-	pcap_sendpacket(pcap_fp, (void *) pktbuf, sizeof(struct ead_packet) + ntohl(pktbuf->msg.len));
+
+	memcpy(sll.sll_addr, pktbuf->eh.ether_dhost, 6);
+	sendto(pkt_fd.fd, pktbuf, sizeof(struct ead_packet) + ntohl(pktbuf->msg.len), 0,
+	       (struct sockaddr *) &sll, sizeof(sll));
 }
 
 static void
-set_state(int nstate)
+set_state(struct ead_instance *in, int nstate)
 {
-	if (state == nstate)
+	if (in->state == nstate)
 		return;
 
-	if (nstate < state) {
+	if (nstate < in->state) {
 		if ((nstate < EAD_TYPE_GET_PRIME) &&
-			(state >= EAD_TYPE_GET_PRIME)) {
-			t_serverclose(ts);
-			ts = NULL;
+			(in->state >= EAD_TYPE_GET_PRIME)) {
+			t_serverclose(in->ts);
+			in->ts = NULL;
 		}
 		goto done;
 	}
 
-	switch(state) {
+	switch(in->state) {
 	case EAD_TYPE_SET_USERNAME:
-		if (!prepare_password())
+		if (!prepare_password(in))
 			goto error;
-		ts = t_serveropenraw(&tpe, tce);
-		if (!ts)
+		in->ts = t_serveropenraw(&in->tpe, in->tce);
+		if (!in->ts)
 			goto error;
 		break;
 	case EAD_TYPE_GET_PRIME:
-		B = t_servergenexp(ts);
+		in->B = t_servergenexp(in->ts);
 		break;
 	case EAD_TYPE_SEND_A:
-		skey = t_servergetkey(ts, &A);
-		if (!skey)
+		in->skey = t_servergetkey(in->ts, &in->A);
+		if (!in->skey)
 			goto error;
 
-		ead_set_key(skey);
+		ead_set_key(in->skey);
 		break;
 	}
 done:
-	state = nstate;
+	in->state = nstate;
 error:
 	return;
 }
 
 static bool
-handle_ping(struct ead_packet *pkt, int len, int *nstate)
+handle_ping(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pktbuf->msg;
 	struct ead_msg_pong *pong = EAD_DATA(msg, pong);
@@ -391,14 +401,14 @@ handle_ping(struct ead_packet *pkt, int len, int *nstate)
 }
 
 static bool
-handle_set_username(struct ead_packet *pkt, int len, int *nstate)
+handle_set_username(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pkt->msg;
 	struct ead_msg_user *user = EAD_DATA(msg, user);
 
-	set_state(EAD_TYPE_SET_USERNAME); /* clear old state */
-	strncpy(username, user->username, sizeof(username));
-	username[sizeof(username) - 1] = 0;
+	set_state(in, EAD_TYPE_SET_USERNAME); /* clear old state */
+	strncpy(in->username, user->username, sizeof(in->username));
+	in->username[sizeof(in->username) - 1] = 0;
 
 	msg = &pktbuf->msg;
 	msg->len = 0;
@@ -408,23 +418,23 @@ handle_set_username(struct ead_packet *pkt, int len, int *nstate)
 }
 
 static bool
-handle_get_prime(struct ead_packet *pkt, int len, int *nstate)
+handle_get_prime(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pktbuf->msg;
 	struct ead_msg_salt *salt = EAD_DATA(msg, salt);
 
 	msg->len = htonl(sizeof(struct ead_msg_salt));
-	salt->prime = tce->index - 1;
-	salt->len = ts->s.len;
-	memcpy(salt->salt, ts->s.data, ts->s.len);
-	memcpy(salt->ext_salt, pw_saltbuf, MAXSALTLEN);
+	salt->prime = in->tce->index - 1;
+	salt->len = in->ts->s.len;
+	memcpy(salt->salt, in->ts->s.data, in->ts->s.len);
+	memcpy(salt->ext_salt, in->pw_saltbuf, MAXSALTLEN);
 
 	*nstate = EAD_TYPE_SEND_A;
 	return true;
 }
 
 static bool
-handle_send_a(struct ead_packet *pkt, int len, int *nstate)
+handle_send_a(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pkt->msg;
 	struct ead_msg_number *number = EAD_DATA(msg, number);
@@ -433,26 +443,26 @@ handle_send_a(struct ead_packet *pkt, int len, int *nstate)
 	if (len > MAXPARAMLEN + 1)
 		return false;
 
-	A.len = len;
-	A.data = abuf;
-	memcpy(A.data, number->data, len);
+	in->A.len = len;
+	in->A.data = in->abuf;
+	memcpy(in->A.data, number->data, len);
 
 	msg = &pktbuf->msg;
 	number = EAD_DATA(msg, number);
-	msg->len = htonl(sizeof(struct ead_msg_number) + B->len);
-	memcpy(number->data, B->data, B->len);
+	msg->len = htonl(sizeof(struct ead_msg_number) + in->B->len);
+	memcpy(number->data, in->B->data, in->B->len);
 
 	*nstate = EAD_TYPE_SEND_AUTH;
 	return true;
 }
 
 static bool
-handle_send_auth(struct ead_packet *pkt, int len, int *nstate)
+handle_send_auth(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pkt->msg;
 	struct ead_msg_auth *auth = EAD_DATA(msg, auth);
 
-	if (t_serververify(ts, auth->data) != 0) {
+	if (t_serververify(in->ts, auth->data) != 0) {
 		DEBUG(2, "Client authentication failed\n");
 		*nstate = EAD_TYPE_SET_USERNAME;
 		return false;
@@ -463,27 +473,131 @@ handle_send_auth(struct ead_packet *pkt, int len, int *nstate)
 	msg->len = htonl(sizeof(struct ead_msg_auth));
 
 	DEBUG(2, "Client authentication successful\n");
-	memcpy(auth->data, t_serverresponse(ts), sizeof(auth->data));
+	memcpy(auth->data, t_serverresponse(in->ts), sizeof(auth->data));
 
 	*nstate = EAD_TYPE_SEND_CMD;
 	return true;
 }
 
+static void
+init_response(struct ead_packet *pkt, int type)
+{
+	pktbuf->msg.magic = htonl(EAD_MAGIC);
+	pktbuf->msg.type = htonl(type + 1);
+	pktbuf->msg.nid = htons(nid);
+	pktbuf->msg.sid = pkt->msg.sid;
+	pktbuf->msg.len = 0;
+}
+
+/* send a chunk of command output, or the final message of a command */
+static void
+cmd_send(struct ead_instance *in, int bytes, bool done)
+{
+	struct ead_msg *msg = &pktbuf->msg;
+	struct ead_msg_cmd_data *cmddata = EAD_ENC_DATA(msg, cmd_data);
+
+	init_response(&in->cmd_pkt, EAD_TYPE_SEND_CMD);
+	cmddata->done = done;
+
+	DEBUG(3, "Sending %d bytes of console data, type=%d\n", bytes, ntohl(msg->type));
+	ead_crypt_select(in->crypt);
+	ead_encrypt_message(msg, sizeof(struct ead_msg_cmd_data) + bytes);
+	ead_send_packet_clone(in, &in->cmd_pkt);
+}
+
+static void
+cmd_stop(struct ead_instance *in)
+{
+	if (in->cmd_fd.fd >= 0) {
+		uloop_fd_delete(&in->cmd_fd);
+		close(in->cmd_fd.fd);
+		in->cmd_fd.fd = -1;
+	}
+
+	uloop_timeout_cancel(&in->cmd_timer);
+}
+
+/* forward pending output, returns false once the pipe is closed */
 static bool
-handle_send_cmd(struct ead_packet *pkt, int len, int *nstate)
+cmd_read(struct ead_instance *in)
+{
+	struct ead_msg_cmd_data *cmddata = EAD_ENC_DATA(&pktbuf->msg, cmd_data);
+	int bytes;
+
+	while (in->cmd_fd.fd >= 0) {
+		bytes = read(in->cmd_fd.fd, cmddata->data, 1024);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+
+		if (bytes < 0 && errno == EAGAIN)
+			return true;
+
+		if (bytes <= 0)
+			return false;
+
+		cmd_send(in, bytes, false);
+	}
+
+	return false;
+}
+
+static void
+cmd_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct ead_instance *in = container_of(fd, struct ead_instance, cmd_fd);
+
+	if (cmd_read(in))
+		return;
+
+	uloop_fd_delete(&in->cmd_fd);
+	close(in->cmd_fd.fd);
+	in->cmd_fd.fd = -1;
+}
+
+static void
+cmd_proc_cb(struct uloop_process *p, int ret)
+{
+	struct ead_instance *in = container_of(p, struct ead_instance, cmd_proc);
+
+	/* pick up what the command wrote right before exiting */
+	cmd_read(in);
+	cmd_stop(in);
+	cmd_send(in, 0, true);
+}
+
+/* keepalive packets every 200 ms so that the client doesn't timeout */
+static void
+cmd_timer_cb(struct uloop_timeout *t)
+{
+	struct ead_instance *in = container_of(t, struct ead_instance, cmd_timer);
+
+	if (time(NULL) >= in->cmd_deadline) {
+		cmd_stop(in);
+		uloop_process_delete(&in->cmd_proc);
+		kill(in->cmd_proc.pid, SIGKILL);
+		return;
+	}
+
+	cmd_send(in, 0, false);
+	uloop_timeout_set(t, PCAP_TIMEOUT);
+}
+
+static bool
+handle_send_cmd(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate)
 {
 	struct ead_msg *msg = &pkt->msg;
 	struct ead_msg_cmd *cmd = EAD_ENC_DATA(msg, cmd);
 	struct ead_msg_cmd_data *cmddata;
-	struct timeval tv, to, tn;
 	int pfd[2], fd;
-	fd_set fds;
 	pid_t pid;
-	bool stream = false;
 	int timeout;
 	int type;
 	int datalen;
 
+	/* the client waits for the running one to finish */
+	if (in->cmd_proc.pending)
+		return false;
+
 	datalen = ead_decrypt_message(msg) - sizeof(struct ead_msg_cmd);
 	if (datalen <= 0)
 		return false;
@@ -491,15 +605,14 @@ handle_send_cmd(struct ead_packet *pkt, int len, int *nstate)
 	type = ntohs(cmd->type);
 	timeout = ntohs(cmd->timeout);
 
-	FD_ZERO(&fds);
 	cmd->data[datalen] = 0;
 	switch(type) {
 	case EAD_CMD_NORMAL:
-		if (pipe(pfd) < 0)
+		/* neither end may leak into children of later commands */
+		if (pipe2(pfd, O_CLOEXEC) < 0)
 			return false;
 
 		fcntl(pfd[0], F_SETFL, O_NONBLOCK | fcntl(pfd[0], F_GETFL));
-		child_pending = true;
 		pid = fork();
 		if (pid == 0) {
 			close(pfd[0]);
@@ -516,9 +629,22 @@ handle_send_cmd(struct ead_packet *pkt, int len, int *nstate)
 			if (!timeout)
 				timeout = EAD_CMD_TIMEOUT;
 
-			stream = true;
-			break;
+			memcpy(&in->cmd_pkt, pkt, sizeof(in->cmd_pkt));
+			in->cmd_deadline = time(NULL) + timeout;
+
+			in->cmd_proc.pid = pid;
+			uloop_process_add(&in->cmd_proc);
+
+			in->cmd_fd.fd = pfd[0];
+			uloop_fd_add(&in->cmd_fd, ULOOP_READ);
+
+			uloop_timeout_set(&in->cmd_timer, PCAP_TIMEOUT);
+
+			/* output and completion are sent from the loop */
+			return false;
 		}
+		close(pfd[0]);
+		close(pfd[1]);
 		return false;
 	case EAD_CMD_BACKGROUND:
 		pid = fork();
@@ -542,37 +668,6 @@ handle_send_cmd(struct ead_packet *pkt, int len, int *nstate)
 
 	msg = &pktbuf->msg;
 	cmddata = EAD_ENC_DATA(msg, cmd_data);
-
-	if (stream) {
-		int nfds, bytes;
-
-		/* send keepalive packets every 200 ms so that the client doesn't timeout */
-		gettimeofday(&to, NULL);
-		memcpy(&tn, &to, sizeof(tn));
-		tv.tv_usec = PCAP_TIMEOUT * 1000;
-		tv.tv_sec = 0;
-		do {
-			cmddata->done = 0;
-			FD_SET(pfd[0], &fds);
-			nfds = select(pfd[0] + 1, &fds, NULL, NULL, &tv);
-			bytes = 0;
-			if (nfds > 0) {
-				bytes = read(pfd[0], cmddata->data, 1024);
-				if (bytes < 0)
-					bytes = 0;
-			}
-			if (!bytes && !child_pending)
-				break;
-			DEBUG(3, "Sending %d bytes of console data, type=%d, timeout=%d\n", bytes, ntohl(msg->type), timeout);
-			ead_encrypt_message(msg, sizeof(struct ead_msg_cmd_data) + bytes);
-			ead_send_packet_clone(pkt);
-			gettimeofday(&tn, NULL);
-		} while (tn.tv_sec < to.tv_sec + timeout);
-		if (child_pending) {
-			kill(pid, SIGKILL);
-			return false;
-		}
-	}
 	cmddata->done = 1;
 	ead_encrypt_message(msg, sizeof(struct ead_msg_cmd_data));
 
@@ -582,20 +677,20 @@ handle_send_cmd(struct ead_packet *pkt, int len, int *nstate)
 
 
 static void
-parse_message(struct ead_packet *pkt, int len)
+parse_message(struct ead_instance *in, struct ead_packet *pkt, int len)
 {
-	bool (*handler)(struct ead_packet *pkt, int len, int *nstate);
+	bool (*handler)(struct ead_instance *in, struct ead_packet *pkt, int len, int *nstate);
 	int min_len = sizeof(struct ead_packet);
-	int nstate = state;
+	int nstate = in->state;
 	int type = ntohl(pkt->msg.type);
 
 	if ((type >= EAD_TYPE_GET_PRIME) &&
-		(state != type))
+		(in->state != type))
 		return;
 
 	if ((type != EAD_TYPE_PING) &&
 		((ntohs(pkt->msg.sid) & EAD_INSTANCE_MASK) >>
-		 EAD_INSTANCE_SHIFT) != instance->id)
+		 EAD_INSTANCE_SHIFT) != in->id)
 		return;
 
 	switch(type) {
@@ -630,26 +725,24 @@ parse_message(struct ead_packet *pkt, int len)
 		return;
 	}
 
-	pktbuf->msg.magic = htonl(EAD_MAGIC);
-	pktbuf->msg.type = htonl(type + 1);
-	pktbuf->msg.nid = htons(nid);
-	pktbuf->msg.sid = pkt->msg.sid;
-	pktbuf->msg.len = 0;
+	ead_crypt_select(in->crypt);
+	init_response(pkt, type);
 
-	if (handler(pkt, len, &nstate)) {
+	if (handler(in, pkt, len, &nstate)) {
 		DEBUG(2, "sending response to packet type %d: %d\n", type + 1, ntohl(pktbuf->msg.len));
 		/* format response packet */
-		ead_send_packet_clone(pkt);
+		ead_send_packet_clone(in, pkt);
 	}
-	set_state(nstate);
+	set_state(in, nstate);
 }
 
 static void
-handle_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *bytes)
+handle_packet(int ifindex, const u_char *bytes, int len)
 {
 	struct ead_packet *pkt = (struct ead_packet *) bytes;
+	struct ead_instance *in;
 
-	if (h->len < sizeof(struct ead_packet))
+	if (len < sizeof(struct ead_packet))
 		return;
 
 	if (pkt->eh.ether_type != htons(ETHERTYPE_IP))
@@ -667,223 +760,247 @@ handle_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *bytes)
 	if (pkt->msg.magic != htonl(EAD_MAGIC))
 		return;
 
-	if (h->len < sizeof(struct ead_packet) + ntohl(pkt->msg.len))
+	if (len < sizeof(struct ead_packet) + ntohl(pkt->msg.len))
 		return;
 
 	if ((pkt->msg.nid != 0xffff) &&
 		(pkt->msg.nid != htons(nid)))
 		return;
 
-	parse_message(pkt, h->len);
+	/* several ports of one bridge all answer pings arriving on it */
+	list_for_each_entry(in, &instances, list) {
+		if (in->rx_ifindex != ifindex)
+			continue;
+
+		parse_message(in, pkt, len);
+	}
 }
 
 static void
-ead_pcap_reopen(bool first)
+pkt_fd_cb(struct uloop_fd *fd, unsigned int events)
 {
-	static char errbuf[PCAP_ERRBUF_SIZE] = "";
-
-	if (pcap_fp_rx && (pcap_fp_rx != pcap_fp))
-		pcap_close(pcap_fp_rx);
-
-	if (pcap_fp)
-		pcap_close(pcap_fp);
+	struct sockaddr_ll sll;
+	socklen_t sll_len;
+	int len;
 
-	pcap_fp_rx = NULL;
-	do {
-		if (instance->bridge[0]) {
-			pcap_fp_rx = ead_open_pcap(instance->bridge, errbuf, 1);
-			pcap_fp = ead_open_pcap(instance->ifname, errbuf, 0);
-		} else {
-			pcap_fp = ead_open_pcap(instance->ifname, errbuf, 1);
-		}
+	while (1) {
+		sll_len = sizeof(sll);
+		len = recvfrom(fd->fd, rxbuf, sizeof(rxbuf), 0,
+			       (struct sockaddr *) &sll, &sll_len);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
 
-		if (!pcap_fp_rx)
-			pcap_fp_rx = pcap_fp;
-		if (first && !pcap_fp) {
-			DEBUG(1, "WARNING: unable to open interface '%s'\n", instance->ifname);
-			first = false;
+			break;
 		}
-		if (!pcap_fp)
-			sleep(1);
-	} while (!pcap_fp);
-	pcap_setfilter(pcap_fp_rx, &pktfilter);
-}
-
 
-static void
-ead_pktloop(void)
-{
-	while (1) {
-		if (pcap_dispatch(pcap_fp_rx, 1, handle_packet, NULL) < 0) {
-			ead_pcap_reopen(false);
+		if (sll.sll_pkttype != PACKET_BROADCAST)
 			continue;
-		}
+
+		handle_packet(sll.sll_ifindex, (u_char *) rxbuf, len);
 	}
 }
 
 
-static int
-usage(const char *prog)
-{
-	fprintf(stderr, "Usage: %s [<options>]\n"
-		"Options:\n"
-		"\t-B             Run in background mode\n"
-		"\t-d <device>    Set the device to listen on\n"
-		"\t-D <name>      Set the name of the device visible to clients\n"
-		"\t-p <file>      Set the password file for authenticating\n"
-		"\t-P <file>      Write a pidfile\n"
-		"\n", prog);
-	return -1;
-}
-
-static void
-server_handle_sigchld(int sig)
+static bool
+is_bridge(int ifindex, char *name)
 {
-	struct ead_instance *in;
-	struct list_head *p;
-	int pid = 0;
-	wait(&pid);
+	char path[64];
 
-	list_for_each(p, &instances) {
-		in = list_entry(p, struct ead_instance, list);
-		if (pid != in->pid)
-			continue;
+	if (!if_indextoname(ifindex, name))
+		return false;
 
-		in->pid = 0;
-		break;
-	}
+	snprintf(path, sizeof(path), "/sys/class/net/%s/bridge", name);
+	return !access(path, F_OK);
 }
 
 static void
-instance_handle_sigchld(int sig)
+update_instance(struct ead_instance *in, int ifindex, int master)
 {
-	int pid = 0;
-	wait(&pid);
-	child_pending = false;
-}
+	char br[IF_NAMESIZE];
 
-static void
-start_server(struct ead_instance *i)
-{
-	if (!nonfork) {
-		i->pid = fork();
-		if (i->pid != 0) {
-			if (i->pid < 0)
-				i->pid = 0;
-			return;
-		}
-	}
+	if (!in->ifindex && ifindex)
+		DEBUG(2, "interface %s is present\n", in->ifname);
 
-	instance = i;
-	signal(SIGCHLD, instance_handle_sigchld);
-	ead_pcap_reopen(true);
-	ead_pktloop();
-	pcap_close(pcap_fp);
-	if (pcap_fp_rx != pcap_fp)
-		pcap_close(pcap_fp_rx);
+	in->ifindex = ifindex;
+	in->rx_ifindex = ifindex;
 
-	exit(0);
+	if (ifindex && master && is_bridge(master, br)) {
+		in->rx_ifindex = master;
+		if (strcmp(in->bridge, br) != 0) {
+			strncpy(in->bridge, br, sizeof(in->bridge) - 1);
+			DEBUG(2, "assigning port %s to bridge %s\n", in->ifname, in->bridge);
+		}
+	} else if (in->bridge[0]) {
+		DEBUG(2, "removing port %s from bridge %s\n", in->ifname, in->bridge);
+		in->bridge[0] = 0;
+	}
 }
 
-
 static void
-start_servers(bool restart)
+handle_link_msg(struct nlmsghdr *nh)
 {
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+	struct rtattr *rta = IFLA_RTA(ifi);
+	int rta_len = IFLA_PAYLOAD(nh);
 	struct ead_instance *in;
-	struct list_head *p;
+	const char *name = NULL;
+	int master = 0;
 
-	list_for_each(p, &instances) {
-		in = list_entry(p, struct ead_instance, list);
-		if (in->pid > 0)
-			continue;
+	if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK)
+		return;
 
-		sleep(1);
-		start_server(in);
+	for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+		if (rta->rta_type == IFLA_IFNAME)
+			name = RTA_DATA(rta);
+		else if (rta->rta_type == IFLA_MASTER)
+			master = *(int *) RTA_DATA(rta);
+	}
+
+	if (!name)
+		return;
+
+	list_for_each_entry(in, &instances, list) {
+		if (!strcmp(in->ifname, name))
+			update_instance(in, nh->nlmsg_type == RTM_NEWLINK ? ifi->ifi_index : 0, master);
+		else if (in->ifindex == ifi->ifi_index)
+			update_instance(in, 0, 0); /* renamed */
 	}
 }
 
-static void
-stop_server(struct ead_instance *in, bool do_free)
+static int
+nl_request_links(void)
 {
-	if (in->pid > 0)
-		kill(in->pid, SIGKILL);
-	in->pid = 0;
-	if (do_free) {
-		list_del(&in->list);
-		free(in);
-	}
+	struct {
+		struct nlmsghdr nh;
+		struct ifinfomsg ifi;
+	} req = {
+		.nh = {
+			.nlmsg_len = sizeof(req),
+			.nlmsg_type = RTM_GETLINK,
+			.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+		},
+		.ifi.ifi_family = AF_UNSPEC,
+	};
+
+	return send(nl_fd.fd, &req, sizeof(req), 0);
 }
 
 static void
-server_handle_sigint(int sig)
+nl_fd_cb(struct uloop_fd *fd, unsigned int events)
 {
-	struct ead_instance *in;
-	struct list_head *p, *tmp;
+	static char buf[8192];
+	struct nlmsghdr *nh;
+	int len;
+
+	while (1) {
+		len = recv(fd->fd, buf, sizeof(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
 
-	list_for_each_safe(p, tmp, &instances) {
-		in = list_entry(p, struct ead_instance, list);
-		stop_server(in, true);
+			/* missed link events, start over with a full dump */
+			if (errno == ENOBUFS)
+				nl_request_links();
+
+			break;
+		}
+
+		for (nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len))
+			handle_link_msg(nh);
 	}
-	exit(1);
 }
 
+/* track interfaces and their bridge membership through link events */
 static int
-check_bridge_port(const char *br, const char *port, void *arg)
+ead_open_netlink(void)
 {
-	struct ead_instance *in;
-	struct list_head *p;
-
-	list_for_each(p, &instances) {
-		in = list_entry(p, struct ead_instance, list);
-
-		if (strcmp(in->ifname, port) != 0)
-			continue;
+	struct sockaddr_nl nl = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = RTMGRP_LINK,
+	};
+	int fd;
 
-		in->br_check = true;
-		if (strcmp(in->bridge, br) == 0)
-			break;
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (fd < 0)
+		return -1;
 
-		strncpy(in->bridge, br, sizeof(in->bridge));
-		DEBUG(2, "assigning port %s to bridge %s\n", in->ifname, in->bridge);
-		stop_server(in, false);
+	if (bind(fd, (struct sockaddr *) &nl, sizeof(nl)) < 0) {
+		close(fd);
+		return -1;
 	}
-	return 0;
+
+	return fd;
 }
 
+
 static int
-check_bridge(const char *name, void *arg)
+usage(const char *prog)
 {
-	br_foreach_port(name, check_bridge_port, arg);
-	return 0;
+	fprintf(stderr, "Usage: %s [<options>]\n"
+		"Options:\n"
+		"\t-B             Run in background mode\n"
+		"\t-d <device>    Set the device to listen on\n"
+		"\t-D <name>      Set the name of the device visible to clients\n"
+		"\t-p <file>      Set the password file for authenticating\n"
+		"\t-P <file>      Write a pidfile\n"
+		"\n", prog);
+	return -1;
 }
 
-static void
-check_all_interfaces(void)
+static struct ead_instance *
+instance_new(const char *ifname, int id)
 {
 	struct ead_instance *in;
-	struct list_head *p;
 
-	br_foreach_bridge(check_bridge, NULL);
+	in = calloc(1, sizeof(struct ead_instance));
+	if (!in)
+		return NULL;
 
-	/* look for interfaces that are no longer part of a bridge */
-	list_for_each(p, &instances) {
-		in = list_entry(p, struct ead_instance, list);
+	in->crypt = ead_crypt_new();
+	if (!in->crypt) {
+		free(in);
+		return NULL;
+	}
 
-		if (in->br_check) {
-			in->br_check = false;
-		} else if (in->bridge[0]) {
-			DEBUG(2, "removing port %s from bridge %s\n", in->ifname, in->bridge);
-			in->bridge[0] = 0;
-			stop_server(in, false);
-		}
+	strncpy(in->ifname, ifname, sizeof(in->ifname) - 1);
+	in->id = id;
+	in->state = EAD_TYPE_SET_USERNAME;
+
+	in->tpe.name = in->username;
+	in->tpe.index = 1;
+	in->tpe.password.data = in->pwbuf;
+	in->tpe.salt.data = in->saltbuf;
+
+	in->cmd_fd.fd = -1;
+	in->cmd_fd.cb = cmd_fd_cb;
+	in->cmd_proc.cb = cmd_proc_cb;
+	in->cmd_timer.cb = cmd_timer_cb;
+
+	return in;
+}
+
+static void
+instance_free(struct ead_instance *in)
+{
+	cmd_stop(in);
+	if (in->cmd_proc.pending) {
+		uloop_process_delete(&in->cmd_proc);
+		kill(in->cmd_proc.pid, SIGKILL);
 	}
+
+	if (in->ts)
+		t_serverclose(in->ts);
+
+	ead_crypt_free(in->crypt);
+	list_del(&in->list);
+	free(in);
 }
 
 
 int main(int argc, char **argv)
 {
-	struct ead_instance *in;
-	struct timeval tv;
+	struct ead_instance *in, *tmp;
 	const char *pidfile = NULL;
 	bool background = false;
 	int n_iface = 0;
@@ -899,17 +1016,17 @@ int main(int argc, char **argv)
 			background = true;
 			break;
 		case 'f':
-			nonfork = true;
+			/* kept for compatibility, there are no per interface processes */
 			break;
 		case 'h':
 			return usage(argv[0]);
 		case 'd':
-			in = malloc(sizeof(struct ead_instance));
-			memset(in, 0, sizeof(struct ead_instance));
-			INIT_LIST_HEAD(&in->list);
-			strncpy(in->ifname, optarg, sizeof(in->ifname) - 1);
+			in = instance_new(optarg, n_iface++);
+			if (!in) {
+				perror("calloc");
+				return -1;
+			}
 			list_add(&in->list, &instances);
-			in->id = n_iface++;
 			break;
 		case 'D':
 			dev_name = optarg;
@@ -922,10 +1039,6 @@ int main(int argc, char **argv)
 			break;
 		}
 	}
-	signal(SIGCHLD, server_handle_sigchld);
-	signal(SIGINT, server_handle_sigint);
-	signal(SIGTERM, server_handle_sigint);
-	signal(SIGKILL, server_handle_sigint);
 
 	if (!n_iface) {
 		fprintf(stderr, "Error: ead needs at least one interface\n");
@@ -959,16 +1072,35 @@ int main(int argc, char **argv)
 	get_random_bytes(ethmac + 3, 3);
 	nid = *(((u16_t *) ethmac) + 2);
 
-	start_servers(false);
-	br_init();
-	tv.tv_sec = 1;
-	tv.tv_usec = 0;
-	while (1) {
-		check_all_interfaces();
-		start_servers(true);
-		sleep(1);
+	pkt_fd.fd = ead_open_socket();
+	if (pkt_fd.fd < 0) {
+		perror("socket");
+		return -1;
+	}
+
+	nl_fd.fd = ead_open_netlink();
+	if (nl_fd.fd < 0) {
+		perror("netlink");
+		return -1;
 	}
-	br_shutdown();
+
+	uloop_init();
+
+	pkt_fd.cb = pkt_fd_cb;
+	uloop_fd_add(&pkt_fd, ULOOP_READ);
+
+	nl_fd.cb = nl_fd_cb;
+	uloop_fd_add(&nl_fd, ULOOP_READ);
+	nl_request_links();
+
+	uloop_run();
+
+	list_for_each_entry_safe(in, tmp, &instances, list)
+		instance_free(in);
+
+	uloop_done();
+	close(pkt_fd.fd);
+	close(nl_fd.fd);
 
 	return 0;
 }
@@ -37,7 +37,7 @@ int main (int argc, char ** argv)
 	}
 
 	printf("/* precompiled expression: %s */\n\n"
-		"static struct bpf_insn pktfilter_insns[] = {\n",
+		"static struct sock_filter pktfilter_insns[] = {\n",
 		argv[1]);
 
 	for (i = 0; i < filter.bf_len; i++) {
@@ -45,9 +45,9 @@ int main (int argc, char ** argv)
 		printf("\t{ .code = 0x%04x, .jt = 0x%02x, .jf = 0x%02x, .k = 0x%08x },\n", in->code, in->jt, in->jf, in->k);
 	}
 	printf("};\n\n"
-		"static struct bpf_program pktfilter = {\n"
-		"\t.bf_len = %d,\n"
-		"\t.bf_insns = pktfilter_insns,\n"
+		"static struct sock_fprog pktfilter = {\n"
+		"\t.len = %d,\n"
+		"\t.filter = pktfilter_insns,\n"
 		"};\n", filter.bf_len);
 	return 0;
 
@@ -44,6 +44,23 @@ struct ubus_banned_client {
 	u8 addr[ETH_ALEN];
 };
 
+/*
+ * An SAE exchange takes several authentication frames (commit, confirm,
+ * anti-clogging token retries), each of them handled on the event loop.
+ * When a subscriber explicitly rejects one of them, the rejection is kept
+ * for the rest of the exchange, so that retries from a rejected client do
+ * not stall the event loop on a ubus round trip per frame. Accepts are not
+ * kept: the source address is all there is to key them on, and anyone can
+ * send frames with the address of a client that was let in.
+ */
+#define UBUS_SAE_VERDICT_TIMEOUT	5
+
+struct ubus_sae_verdict {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	int resp;
+};
+
 static void ubus_receive(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct ubus_context *ctx = eloop_ctx;
@@ -169,6 +186,39 @@ hostapd_bss_del_ban(void *eloop_data, void *user_ctx)
 	free(ban);
 }
 
+static void
+hostapd_bss_del_sae_verdict(void *eloop_data, void *user_ctx)
+{
+	struct ubus_sae_verdict *v = eloop_data;
+	struct hostapd_data *hapd = user_ctx;
+
+	avl_delete(&hapd->ubus.sae_verdicts, &v->avl);
+	free(v);
+}
+
+static void
+hostapd_bss_add_sae_verdict(struct hostapd_data *hapd, const u8 *addr, int resp)
+{
+	struct ubus_sae_verdict *v;
+
+	v = avl_find_element(&hapd->ubus.sae_verdicts, addr, v, avl);
+	if (v) {
+		eloop_cancel_timeout(hostapd_bss_del_sae_verdict, v, hapd);
+	} else {
+		v = os_zalloc(sizeof(*v));
+		if (!v)
+			return;
+
+		memcpy(v->addr, addr, sizeof(v->addr));
+		v->avl.key = v->addr;
+		avl_insert(&hapd->ubus.sae_verdicts, &v->avl);
+	}
+
+	v->resp = resp;
+	eloop_register_timeout(UBUS_SAE_VERDICT_TIMEOUT, 0,
+			       hostapd_bss_del_sae_verdict, v, hapd);
+}
+
 static void
 hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 {
@@ -211,7 +261,7 @@ hostapd_bss_reload(struct ubus_context *ctx, struct ubus_object *obj,
 
 
 static void
-hostapd_parse_vht_map_blobmsg(uint16_t map)
+hostapd_parse_vht_map_blobmsg(struct blob_buf *buf, uint16_t map)
 {
 	char label[4];
 	int16_t val;
@@ -221,13 +271,13 @@ hostapd_parse_vht_map_blobmsg(uint16_t map)
 		snprintf(label, 4, "%dss", i + 1);
 
 		val = (map & (BIT(1) | BIT(0))) + 7;
-		blobmsg_add_u16(&b, label, val == 10 ? -1 : val);
+		blobmsg_add_u16(buf, label, val == 10 ? -1 : val);
 		map = map >> 2;
 	}
 }
 
 static void
-hostapd_parse_vht_capab_blobmsg(struct ieee80211_vht_capabilities *vhtc)
+hostapd_parse_vht_capab_blobmsg(struct blob_buf *buf, struct ieee80211_vht_capabilities *vhtc)
 {
 	void *supported_mcs;
 	void *map;
@@ -242,40 +292,162 @@ hostapd_parse_vht_capab_blobmsg(struct ieee80211_vht_capabilities *vhtc)
 	};
 
 	for (i = 0; i < ARRAY_SIZE(vht_capas); i++)
-		blobmsg_add_u8(&b, vht_capas[i].name,
+		blobmsg_add_u8(buf, vht_capas[i].name,
 				!!(vhtc->vht_capabilities_info & vht_capas[i].flag));
 
-	supported_mcs = blobmsg_open_table(&b, "mcs_map");
+	supported_mcs = blobmsg_open_table(buf, "mcs_map");
 
 	/* RX map */
-	map = blobmsg_open_table(&b, "rx");
-	hostapd_parse_vht_map_blobmsg(le_to_host16(vhtc->vht_supported_mcs_set.rx_map));
-	blobmsg_close_table(&b, map);
+	map = blobmsg_open_table(buf, "rx");
+	hostapd_parse_vht_map_blobmsg(buf, le_to_host16(vhtc->vht_supported_mcs_set.rx_map));
+	blobmsg_close_table(buf, map);
 
 	/* TX map */
-	map = blobmsg_open_table(&b, "tx");
-	hostapd_parse_vht_map_blobmsg(le_to_host16(vhtc->vht_supported_mcs_set.tx_map));
-	blobmsg_close_table(&b, map);
+	map = blobmsg_open_table(buf, "tx");
+	hostapd_parse_vht_map_blobmsg(buf, le_to_host16(vhtc->vht_supported_mcs_set.tx_map));
+	blobmsg_close_table(buf, map);
 
-	blobmsg_close_table(&b, supported_mcs);
+	blobmsg_close_table(buf, supported_mcs);
 }
 
 static void
-hostapd_parse_capab_blobmsg(struct sta_info *sta)
+hostapd_parse_capab_blobmsg(struct blob_buf *buf, struct sta_info *sta)
 {
 	void *r, *v;
 
-	v = blobmsg_open_table(&b, "capabilities");
+	v = blobmsg_open_table(buf, "capabilities");
 
 	if (sta->vht_capabilities) {
-		r = blobmsg_open_table(&b, "vht");
-		hostapd_parse_vht_capab_blobmsg(sta->vht_capabilities);
-		blobmsg_close_table(&b, r);
+		r = blobmsg_open_table(buf, "vht");
+		hostapd_parse_vht_capab_blobmsg(buf, sta->vht_capabilities);
+		blobmsg_close_table(buf, r);
 	}
 
 	/* ToDo: Add HT / HE capability parsing */
 
-	blobmsg_close_table(&b, v);
+	blobmsg_close_table(buf, v);
+}
+
+/*
+ * The taxonomy signature and capabilities of a station do not change while
+ * it is associated, they are encoded once and copied into every get_clients
+ * reply from then on. Entries are dropped on (re)association and when the
+ * station is gone.
+ */
+struct ubus_sta_cache {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	const struct sta_info *sta;
+	bool seen;
+	struct blob_attr *signature;
+	struct blob_attr *capab;
+};
+
+static struct blob_buf sta_buf;
+
+static void
+hostapd_sta_cache_del(struct hostapd_data *hapd, struct ubus_sta_cache *sc)
+{
+	avl_delete(&hapd->ubus.sta_cache, &sc->avl);
+	free(sc->signature);
+	free(sc->capab);
+	free(sc);
+}
+
+static void
+hostapd_sta_cache_drop(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct ubus_sta_cache *sc;
+
+	if (!hapd->ubus.sta_cache.comp)
+		return;
+
+	sc = avl_find_element(&hapd->ubus.sta_cache, addr, sc, avl);
+	if (sc)
+		hostapd_sta_cache_del(hapd, sc);
+}
+
+static void
+hostapd_sta_cache_flush(struct hostapd_data *hapd, bool all)
+{
+	struct ubus_sta_cache *sc, *tmp;
+
+	avl_for_each_element_safe(&hapd->ubus.sta_cache, sc, avl, tmp) {
+		if (all || !sc->seen)
+			hostapd_sta_cache_del(hapd, sc);
+		else
+			sc->seen = false;
+	}
+}
+
+static struct blob_attr *
+hostapd_sta_encode_signature(struct hostapd_data *hapd, struct sta_info *sta)
+{
+#ifdef CONFIG_TAXONOMY
+	char *s;
+
+	blob_buf_init(&sta_buf, 0);
+	s = blobmsg_alloc_string_buffer(&sta_buf, "signature", 1024);
+	if (retrieve_sta_taxonomy(hapd, sta, s, 1024) <= 0)
+		return NULL;
+
+	blobmsg_add_string_buffer(&sta_buf);
+
+	return blob_memdup(sta_buf.head);
+#else
+	return NULL;
+#endif
+}
+
+static struct blob_attr *
+hostapd_sta_encode_capab(struct sta_info *sta)
+{
+	blob_buf_init(&sta_buf, 0);
+	hostapd_parse_capab_blobmsg(&sta_buf, sta);
+
+	return blob_memdup(sta_buf.head);
+}
+
+static struct ubus_sta_cache *
+hostapd_sta_cache_get(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	struct ubus_sta_cache *sc;
+
+	sc = avl_find_element(&hapd->ubus.sta_cache, sta->addr, sc, avl);
+	if (sc && sc->sta != sta) {
+		hostapd_sta_cache_del(hapd, sc);
+		sc = NULL;
+	}
+
+	if (!sc) {
+		sc = os_zalloc(sizeof(*sc));
+		if (!sc)
+			return NULL;
+
+		memcpy(sc->addr, sta->addr, ETH_ALEN);
+		sc->avl.key = sc->addr;
+		sc->sta = sta;
+		sc->signature = hostapd_sta_encode_signature(hapd, sta);
+		sc->capab = hostapd_sta_encode_capab(sta);
+		avl_insert(&hapd->ubus.sta_cache, &sc->avl);
+	}
+
+	sc->seen = true;
+
+	return sc;
+}
+
+static void
+hostapd_sta_cache_put(struct blob_attr *data)
+{
+	struct blob_attr *cur;
+	size_t rem;
+
+	if (!data)
+		return;
+
+	blob_for_each_attr(cur, data, rem)
+		blobmsg_add_blob(&b, cur);
 }
 
 static int
@@ -285,6 +457,7 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
 	struct hostap_sta_driver_data sta_driver_data;
+	struct ubus_sta_cache *sc;
 	struct sta_info *sta;
 	void *list, *c;
 	char mac_buf[20];
@@ -337,11 +510,20 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		blobmsg_close_array(&b, r);
 
 		blobmsg_add_u32(&b, "aid", sta->aid);
-#ifdef CONFIG_TAXONOMY
-		r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
-		if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
-			blobmsg_add_string_buffer(&b);
-#endif
+
+		/* not all of the elements are known before association */
+		sc = NULL;
+		if (sta->flags & WLAN_STA_ASSOC)
+			sc = hostapd_sta_cache_get(hapd, sta);
+
+		if (sc) {
+			hostapd_sta_cache_put(sc->signature);
+		} else {
+			struct blob_attr *sig = hostapd_sta_encode_signature(hapd, sta);
+
+			hostapd_sta_cache_put(sig);
+			free(sig);
+		}
 
 		/* Driver information */
 		if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
@@ -365,13 +547,18 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
 		}
 
-		hostapd_parse_capab_blobmsg(sta);
+		if (sc)
+			hostapd_sta_cache_put(sc->capab);
+		else
+			hostapd_parse_capab_blobmsg(&b, sta);
 
 		blobmsg_close_table(&b, c);
 	}
 	blobmsg_close_array(&b, list);
 	ubus_send_reply(ctx, req, b.head);
 
+	hostapd_sta_cache_flush(hapd, false);
+
 	return 0;
 }
 
@@ -749,6 +936,184 @@ hostapd_config_remove(struct ubus_context *ctx, struct ubus_object *obj,
 	return UBUS_STATUS_OK;
 }
 
+/*
+ * Writes the BSS section of ifname from a radio config file generated by
+ * netifd to a config file of its own: the radio settings in front of the
+ * first BSS, followed by the BSS section with its bss= line turned into
+ * interface=, the form hostapd expects for adding a single BSS.
+ */
+static int
+hostapd_config_write_bss(const char *file, const char *ifname, const char *out)
+{
+	enum { RADIO, SKIP, COPY } state = RADIO;
+	FILE *in, *f;
+	char *line = NULL;
+	size_t len = 0;
+	bool found = false;
+
+	in = fopen(file, "r");
+	if (!in)
+		return -1;
+
+	f = fopen(out, "w");
+	if (!f) {
+		fclose(in);
+		return -1;
+	}
+
+	while (getline(&line, &len, in) > 0) {
+		if (!strncmp(line, "interface=", 10)) {
+			state = SKIP;
+			continue;
+		}
+
+		if (!strncmp(line, "bss=", 4)) {
+			line[strcspn(line, "\r\n")] = 0;
+			state = strcmp(line + 4, ifname) ? SKIP : COPY;
+			if (state == COPY) {
+				fprintf(f, "interface=%s\n", ifname);
+				found = true;
+			}
+			continue;
+		}
+
+		if (state != SKIP)
+			fputs(line, f);
+	}
+
+	free(line);
+	fclose(in);
+	if (fclose(f) || !found) {
+		unlink(out);
+		return -1;
+	}
+
+	return 0;
+}
+
+static bool
+hostapd_config_has_bss(struct hostapd_config *conf, const char *ifname)
+{
+	size_t i;
+
+	for (i = 0; i < conf->num_bss; i++)
+		if (!strcmp(conf->bss[i]->iface, ifname))
+			return true;
+
+	return false;
+}
+
+/*
+ * Brings a running radio in line with its updated config file in one go:
+ * BSSes no longer listed are removed and new ones are added, both without
+ * touching the others, and BSSes with a changed config_id are updated by a
+ * single reload. Anything beyond that, e.g. changed radio settings or a
+ * different BSS order, needs a restart of the radio, which is left to the
+ * caller.
+ */
+static int
+hostapd_config_apply(struct hostapd_iface *iface, const char *file)
+{
+	struct hapd_interfaces *interfaces = iface->interfaces;
+	struct hostapd_config *newconf;
+	char buf[256], *tmp;
+	size_t i;
+	int ret = -1;
+
+	if (!iface->config_fname || strcmp(iface->config_fname, file))
+		return -1;
+
+	newconf = interfaces->config_read_cb(file);
+	if (!newconf)
+		return -1;
+
+	if (!newconf->config_id || !iface->conf->config_id ||
+	    strcmp(newconf->config_id, iface->conf->config_id) ||
+	    strcmp(newconf->bss[0]->iface, iface->conf->bss[0]->iface))
+		goto out;
+
+	for (i = iface->conf->num_bss - 1; i > 0; i--) {
+		if (hostapd_config_has_bss(newconf, iface->conf->bss[i]->iface))
+			continue;
+
+		os_strlcpy(buf, iface->conf->bss[i]->iface, sizeof(buf));
+		if (hostapd_remove_iface(interfaces, buf))
+			goto out;
+	}
+
+	if (iface->conf->num_bss > newconf->num_bss)
+		goto out;
+
+	for (i = 0; i < iface->conf->num_bss; i++)
+		if (strcmp(iface->conf->bss[i]->iface, newconf->bss[i]->iface))
+			goto out;
+
+	for (i = iface->conf->num_bss; i < newconf->num_bss; i++) {
+		if (asprintf(&tmp, "%s.%s", file, newconf->bss[i]->iface) < 0)
+			goto out;
+
+		if (hostapd_config_write_bss(file, newconf->bss[i]->iface, tmp)) {
+			free(tmp);
+			goto out;
+		}
+
+		snprintf(buf, sizeof(buf), "bss_config=%s:%s", iface->phy, tmp);
+		ret = hostapd_add_iface(interfaces, buf);
+		unlink(tmp);
+		free(tmp);
+		if (ret)
+			goto out;
+	}
+
+	ret = hostapd_reload_config(iface, 1);
+
+out:
+	hostapd_config_free(newconf);
+	return ret ? -1 : 0;
+}
+
+static int
+hostapd_config_set(struct ubus_context *ctx, struct ubus_object *obj,
+		   struct ubus_request_data *req, const char *method,
+		   struct blob_attr *msg)
+{
+	struct blob_attr *tb[__CONFIG_MAX];
+	struct hapd_interfaces *interfaces = get_hapd_interfaces_from_object(obj);
+	struct hostapd_iface *iface = NULL;
+	char buf[128];
+	const char *ifname;
+	size_t i;
+
+	blobmsg_parse(config_add_policy, __CONFIG_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (!tb[CONFIG_FILE] || !tb[CONFIG_IFACE])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	ifname = blobmsg_get_string(tb[CONFIG_IFACE]);
+	for (i = 0; i < interfaces->count; i++) {
+		if (!strcmp(interfaces->iface[i]->conf->bss[0]->iface, ifname)) {
+			iface = interfaces->iface[i];
+			break;
+		}
+	}
+
+	if (iface && hostapd_config_apply(iface, blobmsg_get_string(tb[CONFIG_FILE]))) {
+		wpa_printf(MSG_INFO, "Restarting %s to apply its configuration", ifname);
+		os_strlcpy(buf, ifname, sizeof(buf));
+		hostapd_remove_iface(interfaces, buf);
+		iface = NULL;
+	}
+
+	if (!iface)
+		return hostapd_config_add(ctx, obj, req, method, msg);
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "pid", getpid());
+	ubus_send_reply(ctx, req, b.head);
+
+	return UBUS_STATUS_OK;
+}
+
 enum {
 	CSA_FREQ,
 	CSA_BCN_COUNT,
@@ -1119,17 +1484,53 @@ hostapd_rrm_nr_get_own(struct ubus_context *ctx, struct ubus_object *obj,
 	return 0;
 }
 
+enum {
+	NR_LIST_GENERATION,
+	NR_LIST_CURSOR,
+	NR_LIST_LIMIT,
+	__NR_LIST_MAX
+};
+
+static const struct blobmsg_policy nr_list_policy[__NR_LIST_MAX] = {
+	[NR_LIST_GENERATION] = { "generation", BLOBMSG_TYPE_INT32 },
+	[NR_LIST_CURSOR] = { "cursor", BLOBMSG_TYPE_INT32 },
+	[NR_LIST_LIMIT] = { "limit", BLOBMSG_TYPE_INT32 },
+};
+
+/*
+ * Returns the neighbor list along with its generation, which changes with
+ * every update made through ubus. A caller passing the generation it saw
+ * last only gets the list if it has changed since. Large lists can be
+ * fetched in pages: the reply carries a cursor to pass to the next call as
+ * long as there are more entries, a changed generation means the cursor is
+ * stale and the caller has to start over.
+ */
 static int
 hostapd_rrm_nr_list(struct ubus_context *ctx, struct ubus_object *obj,
 		    struct ubus_request_data *req, const char *method,
 		    struct blob_attr *msg)
 {
 	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	struct blob_attr *tb[__NR_LIST_MAX];
 	struct hostapd_neighbor_entry *nr;
+	u32 cursor = 0, limit = 0, idx = 0, n = 0;
+	bool more = false;
 	void *c;
 
+	blobmsg_parse(nr_list_policy, __NR_LIST_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (tb[NR_LIST_CURSOR])
+		cursor = blobmsg_get_u32(tb[NR_LIST_CURSOR]);
+	if (tb[NR_LIST_LIMIT])
+		limit = blobmsg_get_u32(tb[NR_LIST_LIMIT]);
+
 	hostapd_rrm_nr_enable(hapd);
 	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "generation", hapd->ubus.nr_generation);
+
+	if (tb[NR_LIST_GENERATION] &&
+	    blobmsg_get_u32(tb[NR_LIST_GENERATION]) == hapd->ubus.nr_generation)
+		goto out;
 
 	c = blobmsg_open_array(&b, "list");
 	dl_list_for_each(nr, &hapd->nr_db, struct hostapd_neighbor_entry, list) {
@@ -1138,12 +1539,26 @@ hostapd_rrm_nr_list(struct ubus_context *ctx, struct ubus_object *obj,
 		if (!memcmp(nr->bssid, hapd->own_addr, ETH_ALEN))
 			continue;
 
+		if (idx++ < cursor)
+			continue;
+
+		if (limit && n == limit) {
+			more = true;
+			idx--;
+			break;
+		}
+
 		cur = blobmsg_open_array(&b, NULL);
 		hostapd_rrm_print_nr(nr);
 		blobmsg_close_array(&b, cur);
+		n++;
 	}
 	blobmsg_close_array(&b, c);
 
+	if (more)
+		blobmsg_add_u32(&b, "cursor", idx);
+
+out:
 	ubus_send_reply(ctx, req, b.head);
 
 	return 0;
@@ -1151,13 +1566,34 @@ hostapd_rrm_nr_list(struct ubus_context *ctx, struct ubus_object *obj,
 
 enum {
 	NR_SET_LIST,
+	NR_SET_GENERATION,
 	__NR_SET_LIST_MAX
 };
 
 static const struct blobmsg_policy nr_set_policy[__NR_SET_LIST_MAX] = {
 	[NR_SET_LIST] = { "list", BLOBMSG_TYPE_ARRAY },
+	[NR_SET_GENERATION] = { "generation", BLOBMSG_TYPE_INT32 },
 };
 
+/*
+ * Updates carrying the generation that is already in place are skipped.
+ * The generation is only recorded once the update has been applied, so a
+ * rejected list can be sent again with the same generation.
+ */
+static bool
+hostapd_rrm_nr_generation_current(struct hostapd_data *hapd, struct blob_attr *attr)
+{
+	return attr && blobmsg_get_u32(attr) == hapd->ubus.nr_generation;
+}
+
+static void
+hostapd_rrm_nr_commit_generation(struct hostapd_data *hapd, struct blob_attr *attr)
+{
+	if (attr)
+		hapd->ubus.nr_generation = blobmsg_get_u32(attr);
+	else
+		hapd->ubus.nr_generation++;
+}
 
 static void
 hostapd_rrm_nr_clear(struct hostapd_data *hapd)
@@ -1174,20 +1610,145 @@ restart:
 	}
 }
 
-static int
-hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
-		   struct ubus_request_data *req, const char *method,
-		   struct blob_attr *msg)
+/* returns the neighbor report, or NULL if the entry is invalid */
+static struct wpabuf *
+hostapd_rrm_nr_parse_entry(struct hostapd_data *hapd, struct blob_attr *entry,
+			   u8 *bssid, struct wpa_ssid_value *ssid)
 {
 	static const struct blobmsg_policy nr_e_policy[] = {
 		{ .type = BLOBMSG_TYPE_STRING },
 		{ .type = BLOBMSG_TYPE_STRING },
 		{ .type = BLOBMSG_TYPE_STRING },
 	};
+	struct blob_attr *tb[ARRAY_SIZE(nr_e_policy)];
+	struct wpabuf *data;
+	char *s, *nr_s;
+
+	blobmsg_parse_array(nr_e_policy, ARRAY_SIZE(nr_e_policy), tb, blobmsg_data(entry), blobmsg_data_len(entry));
+	if (!tb[0] || !tb[1] || !tb[2])
+		return NULL;
+
+	/* Neighbor Report binary */
+	nr_s = blobmsg_get_string(tb[2]);
+	data = wpabuf_parse_bin(nr_s);
+	if (!data)
+		return NULL;
+
+	/* BSSID */
+	s = blobmsg_get_string(tb[0]);
+	if (strlen(s) == 0) {
+		/* Copy BSSID from neighbor report */
+		if (hwaddr_compact_aton(nr_s, bssid))
+			goto invalid;
+	} else if (hwaddr_aton(s, bssid)) {
+		goto invalid;
+	}
+
+	/* SSID */
+	s = blobmsg_get_string(tb[1]);
+	if (strlen(s) == 0) {
+		/* Copy SSID from hostapd BSS conf */
+		memcpy(ssid, &hapd->conf->ssid, sizeof(*ssid));
+	} else {
+		ssid->ssid_len = strlen(s);
+		if (ssid->ssid_len > sizeof(ssid->ssid))
+			goto invalid;
+
+		memcpy(ssid, s, ssid->ssid_len);
+	}
+
+	return data;
+
+invalid:
+	wpabuf_free(data);
+	return NULL;
+}
+
+/*
+ * Every entry is validated before the neighbor list is touched, so that
+ * a bad entry leaves the previous list in place.
+ */
+static int
+hostapd_rrm_nr_update(struct hostapd_data *hapd, struct blob_attr **tb_l, bool replace)
+{
+	struct wpa_ssid_value ssid;
+	struct blob_attr *cur;
+	struct wpabuf *data;
+	u8 bssid[ETH_ALEN];
+	int rem;
+
+	if (hostapd_rrm_nr_generation_current(hapd, tb_l[NR_SET_GENERATION]))
+		return 0;
+
+	blobmsg_for_each_attr(cur, tb_l[NR_SET_LIST], rem) {
+		data = hostapd_rrm_nr_parse_entry(hapd, cur, bssid, &ssid);
+		if (!data)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		wpabuf_free(data);
+	}
+
+	if (replace)
+		hostapd_rrm_nr_clear(hapd);
+
+	blobmsg_for_each_attr(cur, tb_l[NR_SET_LIST], rem) {
+		data = hostapd_rrm_nr_parse_entry(hapd, cur, bssid, &ssid);
+		if (!data)
+			continue;
+
+		hostapd_neighbor_set(hapd, bssid, &ssid, data, NULL, NULL, 0, 0);
+		wpabuf_free(data);
+	}
+
+	hostapd_rrm_nr_commit_generation(hapd, tb_l[NR_SET_GENERATION]);
+
+	return 0;
+}
+
+static int
+hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
+		   struct ubus_request_data *req, const char *method,
+		   struct blob_attr *msg)
+{
 	struct hostapd_data *hapd = get_hapd_from_object(obj);
 	struct blob_attr *tb_l[__NR_SET_LIST_MAX];
-	struct blob_attr *tb[ARRAY_SIZE(nr_e_policy)];
+
+	hostapd_rrm_nr_enable(hapd);
+
+	blobmsg_parse(nr_set_policy, __NR_SET_LIST_MAX, tb_l, blob_data(msg), blob_len(msg));
+	if (!tb_l[NR_SET_LIST])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	return hostapd_rrm_nr_update(hapd, tb_l, true);
+}
+
+static int
+hostapd_rrm_nr_add(struct ubus_context *ctx, struct ubus_object *obj,
+		   struct ubus_request_data *req, const char *method,
+		   struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	struct blob_attr *tb_l[__NR_SET_LIST_MAX];
+
+	hostapd_rrm_nr_enable(hapd);
+
+	blobmsg_parse(nr_set_policy, __NR_SET_LIST_MAX, tb_l, blob_data(msg), blob_len(msg));
+	if (!tb_l[NR_SET_LIST])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	return hostapd_rrm_nr_update(hapd, tb_l, false);
+}
+
+static int
+hostapd_rrm_nr_del(struct ubus_context *ctx, struct ubus_object *obj,
+		   struct ubus_request_data *req, const char *method,
+		   struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	struct blob_attr *tb_l[__NR_SET_LIST_MAX];
+	struct hostapd_neighbor_entry *nr, *tmp;
 	struct blob_attr *cur;
+	u8 bssid[ETH_ALEN];
 	int rem;
 
 	hostapd_rrm_nr_enable(hapd);
@@ -1196,53 +1757,182 @@ hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
 	if (!tb_l[NR_SET_LIST])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	hostapd_rrm_nr_clear(hapd);
 	blobmsg_for_each_attr(cur, tb_l[NR_SET_LIST], rem) {
-		struct wpa_ssid_value ssid;
-		struct wpabuf *data;
-		u8 bssid[ETH_ALEN];
-		char *s, *nr_s;
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_STRING ||
+		    hwaddr_aton(blobmsg_get_string(cur), bssid))
+			return UBUS_STATUS_INVALID_ARGUMENT;
+	}
 
-		blobmsg_parse_array(nr_e_policy, ARRAY_SIZE(nr_e_policy), tb, blobmsg_data(cur), blobmsg_data_len(cur));
-		if (!tb[0] || !tb[1] || !tb[2])
-			goto invalid;
+	if (hostapd_rrm_nr_generation_current(hapd, tb_l[NR_SET_GENERATION]))
+		return 0;
 
-		/* Neighbor Report binary */
-		nr_s = blobmsg_get_string(tb[2]);
-		data = wpabuf_parse_bin(nr_s);
-		if (!data)
-			goto invalid;
+	blobmsg_for_each_attr(cur, tb_l[NR_SET_LIST], rem) {
+		hwaddr_aton(blobmsg_get_string(cur), bssid);
+		if (!memcmp(bssid, hapd->own_addr, ETH_ALEN))
+			continue;
 
-		/* BSSID */
-		s = blobmsg_get_string(tb[0]);
-		if (strlen(s) == 0) {
-			/* Copy BSSID from neighbor report */
-			if (hwaddr_compact_aton(nr_s, bssid))
-				goto invalid;
-		} else if (hwaddr_aton(s, bssid)) {
-			goto invalid;
+		dl_list_for_each_safe(nr, tmp, &hapd->nr_db,
+				      struct hostapd_neighbor_entry, list) {
+			if (!memcmp(nr->bssid, bssid, ETH_ALEN))
+				hostapd_neighbor_remove(hapd, nr->bssid, &nr->ssid);
 		}
+	}
 
-		/* SSID */
-		s = blobmsg_get_string(tb[1]);
-		if (strlen(s) == 0) {
-			/* Copy SSID from hostapd BSS conf */
-			memcpy(&ssid, &hapd->conf->ssid, sizeof(ssid));
-		} else {
-			ssid.ssid_len = strlen(s);
-			if (ssid.ssid_len > sizeof(ssid.ssid))
-				goto invalid;
+	hostapd_rrm_nr_commit_generation(hapd, tb_l[NR_SET_GENERATION]);
 
-			memcpy(&ssid, s, ssid.ssid_len);
-		}
+	return 0;
+}
 
-		hostapd_neighbor_set(hapd, bssid, &ssid, data, NULL, NULL, 0, 0);
-		wpabuf_free(data);
-		continue;
+/*
+ * Requests for many stations at once are answered with a deferred reply.
+ * The frames are sent from the event loop in bursts of UBUS_BULK_BURST
+ * every UBUS_BULK_INTERVAL ms, and requests queued on the same BSS are
+ * worked off one after the other. The reply carries one result per
+ * station.
+ */
+#define UBUS_BULK_BURST		8
+#define UBUS_BULK_INTERVAL	20
 
-invalid:
-		return UBUS_STATUS_INVALID_ARGUMENT;
+struct ubus_bulk_req {
+	struct dl_list list;
+	struct hostapd_data *hapd;
+	struct ubus_request_data req;
+	void (*send)(struct ubus_bulk_req *bulk, const u8 *addr);
+	struct wpabuf *data;
+	struct blob_attr *msg;
+	struct blob_attr **tb;
+	u8 *addrs;
+	int n_addrs;
+	int idx;
+	struct blob_buf results;
+	void *results_list;
+};
+
+static void hostapd_bulk_run(void *eloop_data, void *user_ctx);
+
+static void
+hostapd_bulk_free(struct ubus_bulk_req *bulk)
+{
+	dl_list_del(&bulk->list);
+	blob_buf_free(&bulk->results);
+	wpabuf_free(bulk->data);
+	free(bulk->msg);
+	free(bulk->tb);
+	free(bulk->addrs);
+	free(bulk);
+}
+
+static void
+hostapd_bulk_finish(struct ubus_bulk_req *bulk, int ret)
+{
+	struct hostapd_data *hapd = bulk->hapd;
+
+	blobmsg_close_array(&bulk->results, bulk->results_list);
+	ubus_send_reply(ctx, &bulk->req, bulk->results.head);
+	ubus_complete_deferred_request(ctx, &bulk->req, ret);
+	hostapd_bulk_free(bulk);
+
+	if (!dl_list_empty(&hapd->ubus.bulk_reqs))
+		eloop_register_timeout(0, UBUS_BULK_INTERVAL * 1000,
+				       hostapd_bulk_run, hapd, NULL);
+}
+
+static void
+hostapd_bulk_run(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_bulk_req *bulk;
+	int i;
+
+	bulk = dl_list_first(&hapd->ubus.bulk_reqs, struct ubus_bulk_req, list);
+	if (!bulk)
+		return;
+
+	for (i = 0; i < UBUS_BULK_BURST && bulk->idx < bulk->n_addrs; i++) {
+		const u8 *addr = &bulk->addrs[bulk->idx++ * ETH_ALEN];
+		void *c;
+
+		c = blobmsg_open_table(&bulk->results, NULL);
+		blobmsg_add_macaddr(&bulk->results, "addr", addr);
+		bulk->send(bulk, addr);
+		blobmsg_close_table(&bulk->results, c);
+	}
+
+	if (bulk->idx < bulk->n_addrs) {
+		eloop_register_timeout(0, UBUS_BULK_INTERVAL * 1000,
+				       hostapd_bulk_run, hapd, NULL);
+		return;
+	}
+
+	hostapd_bulk_finish(bulk, 0);
+}
+
+static void
+hostapd_bulk_flush(struct hostapd_data *hapd)
+{
+	struct ubus_bulk_req *bulk, *tmp;
+
+	if (!hapd->ubus.bulk_reqs.next)
+		return;
+
+	eloop_cancel_timeout(hostapd_bulk_run, hapd, NULL);
+	dl_list_for_each_safe(bulk, tmp, &hapd->ubus.bulk_reqs,
+			      struct ubus_bulk_req, list) {
+		blobmsg_close_array(&bulk->results, bulk->results_list);
+		ubus_send_reply(ctx, &bulk->req, bulk->results.head);
+		ubus_complete_deferred_request(ctx, &bulk->req, UBUS_STATUS_NO_DATA);
+		hostapd_bulk_free(bulk);
 	}
+}
+
+static struct ubus_bulk_req *
+hostapd_bulk_alloc(struct blob_attr *stations, int *status)
+{
+	struct ubus_bulk_req *bulk;
+	struct blob_attr *cur;
+	int n, rem;
+
+	n = blobmsg_check_array(stations, BLOBMSG_TYPE_STRING);
+	if (n <= 0) {
+		*status = UBUS_STATUS_INVALID_ARGUMENT;
+		return NULL;
+	}
+
+	bulk = os_zalloc(sizeof(*bulk));
+	if (bulk)
+		bulk->addrs = os_calloc(n, ETH_ALEN);
+	if (!bulk || !bulk->addrs) {
+		free(bulk);
+		*status = UBUS_STATUS_UNKNOWN_ERROR;
+		return NULL;
+	}
+
+	blobmsg_for_each_attr(cur, stations, rem) {
+		if (hwaddr_aton(blobmsg_get_string(cur),
+				&bulk->addrs[bulk->n_addrs++ * ETH_ALEN])) {
+			free(bulk->addrs);
+			free(bulk);
+			*status = UBUS_STATUS_INVALID_ARGUMENT;
+			return NULL;
+		}
+	}
+
+	return bulk;
+}
+
+static int
+hostapd_bulk_start(struct hostapd_data *hapd, struct ubus_bulk_req *bulk,
+		   struct ubus_request_data *req)
+{
+	bulk->hapd = hapd;
+	blob_buf_init(&bulk->results, 0);
+	bulk->results_list = blobmsg_open_array(&bulk->results, "results");
+
+	if (dl_list_empty(&hapd->ubus.bulk_reqs))
+		eloop_register_timeout(0, 0, hostapd_bulk_run, hapd, NULL);
+
+	dl_list_add_tail(&hapd->ubus.bulk_reqs, &bulk->list);
+	ubus_defer_request(ctx, req, &bulk->req);
 
 	return 0;
 }
@@ -1255,6 +1945,7 @@ enum {
 	BEACON_REQ_DURATION,
 	BEACON_REQ_BSSID,
 	BEACON_REQ_SSID,
+	BEACON_REQ_STATIONS,
 	__BEACON_REQ_MAX,
 };
 
@@ -1266,8 +1957,24 @@ static const struct blobmsg_policy beacon_req_policy[__BEACON_REQ_MAX] = {
 	[BEACON_REQ_MODE] { "mode", BLOBMSG_TYPE_INT32 },
 	[BEACON_REQ_BSSID] { "bssid", BLOBMSG_TYPE_STRING },
 	[BEACON_REQ_SSID] { "ssid", BLOBMSG_TYPE_STRING },
+	[BEACON_REQ_STATIONS] { "stations", BLOBMSG_TYPE_ARRAY },
 };
 
+static void
+hostapd_rrm_beacon_req_send(struct ubus_bulk_req *bulk, const u8 *addr)
+{
+	int ret;
+
+	ret = hostapd_send_beacon_req(bulk->hapd, addr, 0, bulk->data);
+	if (ret < 0) {
+		blobmsg_add_u32(&bulk->results, "status", -ret);
+		return;
+	}
+
+	blobmsg_add_u32(&bulk->results, "status", 0);
+	blobmsg_add_u32(&bulk->results, "dialog_token", ret);
+}
+
 static int
 hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		       struct ubus_request_data *ureq, const char *method,
@@ -1275,6 +1982,7 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
 	struct blob_attr *tb[__BEACON_REQ_MAX];
+	struct ubus_bulk_req *bulk = NULL;
 	struct blob_attr *cur;
 	struct wpabuf *req;
 	u8 bssid[ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
@@ -1284,7 +1992,8 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 
 	blobmsg_parse(beacon_req_policy, __BEACON_REQ_MAX, tb, blob_data(msg), blob_len(msg));
 
-	if (!tb[BEACON_REQ_ADDR] || !tb[BEACON_REQ_MODE] || !tb[BEACON_REQ_DURATION] ||
+	if ((!tb[BEACON_REQ_ADDR] && !tb[BEACON_REQ_STATIONS]) ||
+	    !tb[BEACON_REQ_MODE] || !tb[BEACON_REQ_DURATION] ||
 	    !tb[BEACON_REQ_OP_CLASS] || !tb[BEACON_REQ_CHANNEL])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
@@ -1292,16 +2001,25 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		buf_len += blobmsg_data_len(tb[BEACON_REQ_SSID]) + 2 - 1;
 
 	mode = blobmsg_get_u32(tb[BEACON_REQ_MODE]);
-	if (hwaddr_aton(blobmsg_data(tb[BEACON_REQ_ADDR]), addr))
+	if (tb[BEACON_REQ_STATIONS]) {
+		bulk = hostapd_bulk_alloc(tb[BEACON_REQ_STATIONS], &ret);
+		if (!bulk)
+			return ret;
+	} else if (hwaddr_aton(blobmsg_data(tb[BEACON_REQ_ADDR]), addr)) {
 		return UBUS_STATUS_INVALID_ARGUMENT;
+	}
 
 	if (tb[BEACON_REQ_BSSID] &&
-	    hwaddr_aton(blobmsg_data(tb[BEACON_REQ_BSSID]), bssid))
-		return UBUS_STATUS_INVALID_ARGUMENT;
+	    hwaddr_aton(blobmsg_data(tb[BEACON_REQ_BSSID]), bssid)) {
+		ret = UBUS_STATUS_INVALID_ARGUMENT;
+		goto out_bulk;
+	}
 
 	req = wpabuf_alloc(buf_len);
-	if (!req)
-		return UBUS_STATUS_UNKNOWN_ERROR;
+	if (!req) {
+		ret = UBUS_STATUS_UNKNOWN_ERROR;
+		goto out_bulk;
+	}
 
 	/* 1: regulatory class */
 	wpabuf_put_u8(req, blobmsg_get_u32(tb[BEACON_REQ_OP_CLASS]));
@@ -1327,11 +2045,25 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		wpabuf_put_data(req, blobmsg_data(cur), blobmsg_data_len(cur) - 1);
 	}
 
+	if (bulk) {
+		bulk->data = req;
+		bulk->send = hostapd_rrm_beacon_req_send;
+		return hostapd_bulk_start(hapd, bulk, ureq);
+	}
+
 	ret = hostapd_send_beacon_req(hapd, addr, 0, req);
+	wpabuf_free(req);
 	if (ret < 0)
 		return -ret;
 
 	return 0;
+
+out_bulk:
+	if (bulk) {
+		free(bulk->addrs);
+		free(bulk);
+	}
+	return ret;
 }
 
 enum {
@@ -1537,6 +2269,7 @@ enum {
 	BSS_TR_NEIGHBORS,
 	BSS_TR_ABRIDGED,
 	BSS_TR_DIALOG_TOKEN,
+	BSS_TR_STATIONS,
 #ifdef CONFIG_MBO
 	BSS_TR_MBO_REASON,
 	BSS_TR_CELL_PREF,
@@ -1553,6 +2286,7 @@ static const struct blobmsg_policy bss_tr_policy[__BSS_TR_DISASSOC_MAX] = {
 	[BSS_TR_NEIGHBORS] = { "neighbors", BLOBMSG_TYPE_ARRAY },
 	[BSS_TR_ABRIDGED] = { "abridged", BLOBMSG_TYPE_BOOL },
 	[BSS_TR_DIALOG_TOKEN] = { "dialog_token", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_STATIONS] = { "stations", BLOBMSG_TYPE_ARRAY },
 #ifdef CONFIG_MBO
 	[BSS_TR_MBO_REASON] = { "mbo_reason", BLOBMSG_TYPE_INT32 },
 	[BSS_TR_CELL_PREF] = { "cell_pref", BLOBMSG_TYPE_INT32 },
@@ -1561,30 +2295,16 @@ static const struct blobmsg_policy bss_tr_policy[__BSS_TR_DISASSOC_MAX] = {
 };
 
 static int
-hostapd_bss_transition_request(struct ubus_context *ctx, struct ubus_object *obj,
-			       struct ubus_request_data *ureq, const char *method,
-			       struct blob_attr *msg)
+hostapd_bss_tr_send_msg(struct hostapd_data *hapd, const u8 *addr, struct blob_attr **tb)
 {
-	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
-	struct blob_attr *tb[__BSS_TR_DISASSOC_MAX];
-	struct sta_info *sta;
 	u32 da_timer = 0;
 	u32 valid_period = 0;
-	u8 addr[ETH_ALEN];
 	u32 dialog_token = 1;
 	bool abridged;
 	bool da_imminent;
-	u8 mbo_reason;
-	u8 cell_pref;
-	u8 reassoc_delay;
-
-	blobmsg_parse(bss_tr_policy, __BSS_TR_DISASSOC_MAX, tb, blob_data(msg), blob_len(msg));
-
-	if (!tb[BSS_TR_ADDR])
-		return UBUS_STATUS_INVALID_ARGUMENT;
-
-	if (hwaddr_aton(blobmsg_data(tb[BSS_TR_ADDR]), addr))
-		return UBUS_STATUS_INVALID_ARGUMENT;
+	u8 mbo_reason = 0;
+	u8 cell_pref = 0;
+	u8 reassoc_delay = 0;
 
 	if (tb[BSS_TR_DA_TIMER])
 		da_timer = blobmsg_get_u32(tb[BSS_TR_DA_TIMER]);
@@ -1609,9 +2329,60 @@ hostapd_bss_transition_request(struct ubus_context *ctx, struct ubus_object *obj
 		reassoc_delay = blobmsg_get_u32(tb[BSS_TR_REASSOC_DELAY]);
 #endif
 
-	return hostapd_bss_tr_send(hapd, addr, da_imminent, abridged, da_timer, valid_period,
+	return hostapd_bss_tr_send(hapd, (u8 *) addr, da_imminent, abridged, da_timer, valid_period,
 				   dialog_token, tb[BSS_TR_NEIGHBORS], mbo_reason, cell_pref, reassoc_delay);
 }
+
+static void
+hostapd_bss_tr_bulk_send(struct ubus_bulk_req *bulk, const u8 *addr)
+{
+	blobmsg_add_u32(&bulk->results, "status",
+			hostapd_bss_tr_send_msg(bulk->hapd, addr, bulk->tb));
+}
+
+static int
+hostapd_bss_transition_request(struct ubus_context *ctx, struct ubus_object *obj,
+			       struct ubus_request_data *ureq, const char *method,
+			       struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	struct blob_attr *tb[__BSS_TR_DISASSOC_MAX];
+	struct ubus_bulk_req *bulk;
+	u8 addr[ETH_ALEN];
+	int ret;
+
+	blobmsg_parse(bss_tr_policy, __BSS_TR_DISASSOC_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (tb[BSS_TR_STATIONS]) {
+		bulk = hostapd_bulk_alloc(tb[BSS_TR_STATIONS], &ret);
+		if (!bulk)
+			return ret;
+
+		/* parsed once, the attributes point into the copy of the message */
+		bulk->msg = blob_memdup(msg);
+		bulk->tb = os_calloc(__BSS_TR_DISASSOC_MAX, sizeof(*bulk->tb));
+		if (!bulk->msg || !bulk->tb) {
+			free(bulk->msg);
+			free(bulk->tb);
+			free(bulk->addrs);
+			free(bulk);
+			return UBUS_STATUS_UNKNOWN_ERROR;
+		}
+
+		blobmsg_parse(bss_tr_policy, __BSS_TR_DISASSOC_MAX, bulk->tb,
+			      blob_data(bulk->msg), blob_len(bulk->msg));
+		bulk->send = hostapd_bss_tr_bulk_send;
+		return hostapd_bulk_start(hapd, bulk, ureq);
+	}
+
+	if (!tb[BSS_TR_ADDR])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (hwaddr_aton(blobmsg_data(tb[BSS_TR_ADDR]), addr))
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	return hostapd_bss_tr_send_msg(hapd, addr, tb);
+}
 #endif
 
 #ifdef CONFIG_AIRTIME_POLICY
@@ -1691,8 +2462,10 @@ static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD("notify_response", hostapd_notify_response, notify_policy),
 	UBUS_METHOD("bss_mgmt_enable", hostapd_bss_mgmt_enable, bss_mgmt_enable_policy),
 	UBUS_METHOD_NOARG("rrm_nr_get_own", hostapd_rrm_nr_get_own),
-	UBUS_METHOD_NOARG("rrm_nr_list", hostapd_rrm_nr_list),
+	UBUS_METHOD("rrm_nr_list", hostapd_rrm_nr_list, nr_list_policy),
 	UBUS_METHOD("rrm_nr_set", hostapd_rrm_nr_set, nr_set_policy),
+	UBUS_METHOD("rrm_nr_add", hostapd_rrm_nr_add, nr_set_policy),
+	UBUS_METHOD("rrm_nr_del", hostapd_rrm_nr_del, nr_set_policy),
 	UBUS_METHOD("rrm_beacon_req", hostapd_rrm_beacon_req, beacon_req_policy),
 	UBUS_METHOD("link_measurement_req", hostapd_rrm_lm_req, lm_req_policy),
 #ifdef CONFIG_WNM_AP
@@ -1726,6 +2499,9 @@ void hostapd_ubus_add_bss(struct hostapd_data *hapd)
 		return;
 
 	avl_init(&hapd->ubus.banned, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.sae_verdicts, avl_compare_macaddr, false, NULL);
+	dl_list_init(&hapd->ubus.bulk_reqs);
+	avl_init(&hapd->ubus.sta_cache, avl_compare_macaddr, false, NULL);
 	obj->name = name;
 	obj->type = &bss_object_type;
 	obj->methods = bss_object_type.methods;
@@ -1740,6 +2516,7 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 {
 	struct ubus_object *obj = &hapd->ubus.obj;
 	char *name = (char *) obj->name;
+	struct ubus_sae_verdict *v, *tmp;
 
 #ifdef CONFIG_MESH
 	if (hapd->conf->mesh & MESH_ENABLED)
@@ -1751,6 +2528,15 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 
 	hostapd_send_shared_event(&hapd->iface->interfaces->ubus, hapd->conf->iface, "remove");
 
+	avl_for_each_element_safe(&hapd->ubus.sae_verdicts, v, avl, tmp) {
+		eloop_cancel_timeout(hostapd_bss_del_sae_verdict, v, hapd);
+		hostapd_bss_del_sae_verdict(v, hapd);
+	}
+
+	hostapd_bulk_flush(hapd);
+	if (hapd->ubus.sta_cache.comp)
+		hostapd_sta_cache_flush(hapd, true);
+
 	if (obj->id) {
 		ubus_remove_object(ctx, obj);
 		hostapd_ubus_ref_dec();
@@ -1799,6 +2585,7 @@ void hostapd_ubus_remove_vlan(struct hostapd_data *hapd, struct hostapd_vlan *vl
 static const struct ubus_method daemon_methods[] = {
 	UBUS_METHOD("config_add", hostapd_config_add, config_add_policy),
 	UBUS_METHOD("config_remove", hostapd_config_remove, config_remove_policy),
+	UBUS_METHOD("config_set", hostapd_config_set, config_add_policy),
 };
 
 static struct ubus_object_type daemon_object_type =
@@ -1840,6 +2627,7 @@ void hostapd_ubus_free(struct hapd_interfaces *interfaces)
 struct ubus_event_req {
 	struct ubus_notify_request nreq;
 	int resp;
+	bool replied;
 };
 
 static void
@@ -1848,6 +2636,7 @@ ubus_event_cb(struct ubus_notify_request *req, int idx, int ret)
 	struct ubus_event_req *ureq = container_of(req, struct ubus_event_req, nreq);
 
 	ureq->resp = ret;
+	ureq->replied = true;
 }
 
 int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_request *req)
@@ -1860,13 +2649,18 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	};
 	const char *type = "mgmt";
 	struct ubus_event_req ureq = {};
+	struct ubus_sae_verdict *v = NULL;
 	const u8 *addr;
+	int sae = 0;
 
 	if (req->mgmt_frame)
 		addr = req->mgmt_frame->sa;
 	else
 		addr = req->addr;
 
+	if (req->type == HOSTAPD_UBUS_ASSOC_REQ)
+		hostapd_sta_cache_drop(hapd, addr);
+
 	ban = avl_find_element(&hapd->ubus.banned, addr, ban, avl);
 	if (ban)
 		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
@@ -1874,6 +2668,13 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	if (!hapd->ubus.obj.has_subscribers)
 		return WLAN_STATUS_SUCCESS;
 
+	if (req->type == HOSTAPD_UBUS_AUTH_REQ && req->mgmt_frame &&
+	    le_to_host16(req->mgmt_frame->u.auth.auth_alg) == WLAN_AUTH_SAE) {
+		v = avl_find_element(&hapd->ubus.sae_verdicts, addr, v, avl);
+		if (!v)
+			sae = hapd->ubus.notify_response;
+	}
+
 	if (req->type < ARRAY_SIZE(types))
 		type = types[req->type];
 
@@ -1926,9 +2727,13 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		}
 	}
 
-	if (!hapd->ubus.notify_response) {
+	/* with a cached SAE rejection, subscribers still see the frame but are
+	 * not waited for */
+	if (!hapd->ubus.notify_response || v) {
+		int resp = v ? v->resp : WLAN_STATUS_SUCCESS;
+
 		ubus_notify(ctx, &hapd->ubus.obj, type, b.head, -1);
-		return WLAN_STATUS_SUCCESS;
+		return resp;
 	}
 
 	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ureq.nreq))
@@ -1937,6 +2742,9 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	ureq.nreq.status_cb = ubus_event_cb;
 	ubus_complete_request(ctx, &ureq.nreq.req, 100);
 
+	if (sae && ureq.replied && ureq.resp)
+		hostapd_bss_add_sae_verdict(hapd, addr, ureq.resp);
+
 	if (ureq.resp)
 		return ureq.resp;
 
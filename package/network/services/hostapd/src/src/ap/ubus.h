@@ -36,7 +36,11 @@ struct rrm_measurement_beacon_report;
 struct hostapd_ubus_bss {
 	struct ubus_object obj;
 	struct avl_tree banned;
+	struct avl_tree sae_verdicts;
+	struct dl_list bulk_reqs;
+	struct avl_tree sta_cache;
 	int notify_response;
+	u32 nr_generation;
 };
 
 void hostapd_ubus_add_iface(struct hostapd_iface *iface);
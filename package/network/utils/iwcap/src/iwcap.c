@@ -27,14 +27,22 @@
 #include <syslog.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
@@ -45,22 +53,62 @@
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
 
+#define RX_BLOCK_SIZE				(64 * 1024)
+#define RX_FRAME_SIZE				2048
+#define RX_BLOCK_TIMEOUT			100 /* ms */
+
+#define OUT_BATCH					256 /* frames per writev(), 3 iovecs each */
+
+#define PCAPNG_SHB					0x0A0D0D0A
+#define PCAPNG_IDB					0x00000001
+#define PCAPNG_ISB					0x00000005
+#define PCAPNG_EPB					0x00000006
+
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
 #else
 #define le16(x) (x)
 #endif
 
+/* two 16 bit pcapng fields in file order, packed into a host order word */
+#if __BYTE_ORDER == __BIG_ENDIAN
+#define pcapng_u16x2(a, b) (((uint32_t)(a) << 16) | (b))
+#else
+#define pcapng_u16x2(a, b) ((a) | ((uint32_t)(b) << 16))
+#endif
+
 uint8_t run_dump   = 0;
 uint8_t run_stop   = 0;
 uint8_t run_daemon = 0;
 
 uint32_t frames_captured = 0;
 uint32_t frames_filtered = 0;
+uint32_t frames_dropped  = 0;    /* lost on write */
+
+uint64_t kernel_received = 0;    /* PACKET_STATISTICS totals */
+uint64_t kernel_dropped  = 0;
+
+uint8_t streaming     = 0;
+uint8_t filter_data   = 0;
+uint8_t filter_beacon = 0;
 
 int capture_sock = -1;
 const char *ifname = NULL;
 
+struct ringbuf *ring = NULL;
+uint16_t pktcap = 256;
+
+/* TPACKET_V3 receive ring */
+uint8_t *rx_map = NULL;
+struct tpacket_req3 rx_req;
+
+/* rotating pcapng output */
+const char *wprefix = NULL;
+const char *wcomp   = NULL;
+uint32_t wsize  = 0;
+uint32_t wtime  = 0;
+uint32_t wfiles = 0;
+
 
 struct ringbuf {
 	uint32_t len;            /* number of slots */
@@ -93,6 +141,33 @@ typedef struct pcaprec_hdr_s {
 	uint32_t orig_len;       /* actual length of packet */
 } pcaprec_hdr_t;
 
+typedef struct pcapng_epb_s {
+	uint32_t type;           /* PCAPNG_EPB */
+	uint32_t len;            /* total block length */
+	uint32_t iface;          /* interface id */
+	uint32_t ts_high;        /* timestamp microseconds, upper 32 bit */
+	uint32_t ts_low;         /* timestamp microseconds, lower 32 bit */
+	uint32_t incl_len;       /* number of octets of packet saved in file */
+	uint32_t orig_len;       /* actual length of packet */
+} pcapng_epb_t;
+
+struct output {
+	int fd;                  /* file or compressor pipe, -1 if closed */
+	pid_t filter;            /* compressor process */
+	uint32_t seq;            /* next file number */
+	uint64_t bytes;          /* bytes written to current file */
+	time_t since;            /* creation time of current file */
+	uint8_t failed;          /* last open failed, don't repeat error */
+
+	uint32_t nframes;        /* frames queued for writev() */
+	uint32_t pending;        /* bytes queued for writev() */
+	struct iovec iov[OUT_BATCH * 3];
+	pcapng_epb_t epb[OUT_BATCH];
+	uint32_t tail[OUT_BATCH][2];
+};
+
+struct output out = { .fd = -1 };
+
 typedef struct ieee80211_radiotap_header {
 	u_int8_t  it_version;    /* set to 0 */
 	u_int8_t  it_pad;
@@ -268,40 +343,489 @@ void msg(const char *fmt, ...)
 }
 
 
+void update_stats(void)
+{
+	struct tpacket_stats_v3 st = { 0 };
+	socklen_t len = sizeof(st);
+
+	/* counters are reset by the kernel on every read */
+	if (!getsockopt(capture_sock, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+	{
+		kernel_received += st.tp_packets;
+		kernel_dropped  += st.tp_drops;
+	}
+}
+
+
+/* write out a whole iovec array, coping with short writes to pipes */
+int write_all(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t n;
+
+	while (cnt > 0)
+	{
+		n = writev(fd, iov, cnt);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+
+		while (cnt > 0 && (size_t)n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+
+		if (cnt > 0)
+		{
+			iov->iov_base = (uint8_t *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+void out_path(char *buf, size_t len, uint32_t seq)
+{
+	snprintf(buf, len, "%s.%u.pcapng%s", wprefix, seq,
+			 !wcomp ? "" : strcmp(wcomp, "zstd") ? ".lz4" : ".zst");
+}
+
+void out_close(void)
+{
+	struct timeval tv;
+	uint64_t ts, osdrop = frames_dropped;
+	uint32_t isb[16];
+	struct iovec iov = { .iov_base = isb, .iov_len = sizeof(isb) };
+
+	if (out.fd < 0)
+		return;
+
+	/* finish the file with the drop statistics seen so far */
+	update_stats();
+	gettimeofday(&tv, NULL);
+	ts = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+	isb[0]  = PCAPNG_ISB;
+	isb[1]  = sizeof(isb);
+	isb[2]  = 0;
+	isb[3]  = ts >> 32;
+	isb[4]  = ts & 0xFFFFFFFF;
+	isb[5]  = pcapng_u16x2(4, 8);  /* isb_ifrecv */
+	memcpy(&isb[6], &kernel_received, 8);
+	isb[8]  = pcapng_u16x2(5, 8);  /* isb_ifdrop */
+	memcpy(&isb[9], &kernel_dropped, 8);
+	isb[11] = pcapng_u16x2(7, 8);  /* isb_osdrop */
+	memcpy(&isb[12], &osdrop, 8);
+	isb[14] = 0;                   /* opt_endofopt */
+	isb[15] = sizeof(isb);
+
+	write_all(out.fd, &iov, 1);
+	close(out.fd);
+
+	if (out.filter > 0)
+		waitpid(out.filter, NULL, 0);
+
+	out.fd = -1;
+	out.filter = 0;
+}
+
+int out_open(void)
+{
+	char path[PATH_MAX];
+	int fd, pfd[2];
+	uint32_t hdr[64];
+	size_t nlen = strlen(ifname);
+	struct iovec iov = { .iov_base = hdr };
+
+	/* make room on the filesystem before creating the next file */
+	if (wfiles && out.seq >= wfiles)
+	{
+		out_path(path, sizeof(path), out.seq - wfiles);
+		unlink(path);
+	}
+
+	out_path(path, sizeof(path), out.seq);
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		if (!out.failed)
+			msg("Unable to open %s: %s\n", path, strerror(errno));
+
+		out.failed = 1;
+		return -1;
+	}
+
+	if (wcomp)
+	{
+		if (pipe(pfd))
+		{
+			msg("Unable to create pipe: %s\n", strerror(errno));
+			close(fd);
+			return -1;
+		}
+
+		switch ((out.filter = fork()))
+		{
+			case -1:
+				msg("Unable to fork: %s\n", strerror(errno));
+				close(pfd[0]);
+				close(pfd[1]);
+				close(fd);
+				out.filter = 0;
+				return -1;
+
+			case 0:
+				dup2(pfd[0], 0);
+				dup2(fd, 1);
+				close(pfd[0]);
+				close(pfd[1]);
+				close(fd);
+				close(capture_sock);
+				execlp(wcomp, wcomp, "-q", "-c", NULL);
+				_exit(127);
+
+			default:
+				close(pfd[0]);
+				close(fd);
+				fd = pfd[1];
+				break;
+		}
+	}
+
+	/* section header block */
+	hdr[0] = PCAPNG_SHB;
+	hdr[1] = 28;
+	hdr[2] = 0x1A2B3C4D;
+	hdr[3] = pcapng_u16x2(1, 0);  /* version 1.0 */
+	hdr[4] = 0xFFFFFFFF;      /* section length unknown */
+	hdr[5] = 0xFFFFFFFF;
+	hdr[6] = 28;
+
+	/* interface description block with an if_name option */
+	if (nlen > IFNAMSIZ)
+		nlen = IFNAMSIZ;
+
+	memset(&hdr[7], 0, sizeof(hdr) - 7 * sizeof(uint32_t));
+	hdr[7]  = PCAPNG_IDB;
+	hdr[8]  = 16 + 4 + ((nlen + 3) & ~3) + 4 + 4;
+	hdr[9]  = pcapng_u16x2(DLT_IEEE802_11_RADIO, 0);
+	hdr[10] = 0xFFFF;                  /* snaplen */
+	hdr[11] = pcapng_u16x2(2, nlen);   /* if_name */
+	memcpy(&hdr[12], ifname, nlen);
+	hdr[12 + (nlen + 3) / 4] = 0;   /* opt_endofopt */
+	hdr[13 + (nlen + 3) / 4] = hdr[8];
+
+	iov.iov_len = 28 + hdr[8];
+
+	if (write_all(fd, &iov, 1))
+	{
+		msg("Unable to write to %s: %s\n", path, strerror(errno));
+		close(fd);
+
+		if (out.filter > 0)
+			waitpid(out.filter, NULL, 0);
+
+		out.filter = 0;
+		return -1;
+	}
+
+	out.fd = fd;
+	out.seq++;
+	out.bytes = iov.iov_len;
+	out.since = time(NULL);
+	out.failed = 0;
+
+	return 0;
+}
+
+/* close the current file once it is older than the -G interval */
+void out_rotate(void)
+{
+	if (out.fd >= 0 && wtime && time(NULL) - out.since >= wtime)
+		out_close();
+}
+
+/* milliseconds until out_rotate() is due, -1 if it never is */
+int out_timeout(void)
+{
+	time_t left;
+
+	if (out.fd < 0 || !wtime)
+		return -1;
+
+	left = out.since + wtime - time(NULL);
+
+	return (left > 0) ? left * 1000 : 0;
+}
+
+/* write all queued frames, must happen before their ring block is released */
+void out_flush(void)
+{
+	if (!out.nframes)
+		return;
+
+	if (out.fd < 0)
+		out_open();
+
+	if (out.fd < 0 || write_all(out.fd, out.iov, out.nframes * 3))
+	{
+		/* a full filesystem or a dead compressor, drop the batch and start
+		 * over with a new file, which also expires the oldest one */
+		if (out.fd >= 0)
+			msg("Unable to write capture: %s\n", strerror(errno));
+
+		frames_dropped += out.nframes;
+		out_close();
+	}
+	else
+	{
+		out.bytes += out.pending;
+	}
+
+	out.nframes = 0;
+	out.pending = 0;
+
+	if (out.fd >= 0 && wsize && out.bytes >= wsize)
+		out_close();
+	else
+		out_rotate();
+}
+
+void out_frame(uint8_t *data, uint32_t len, uint32_t olen, struct timeval *tv)
+{
+	struct timeval now;
+	struct iovec *iov;
+	pcapng_epb_t *epb;
+	uint32_t *tail;
+	uint32_t pad = (4 - (len & 3)) & 3;
+	uint64_t ts;
+
+	if (out.nframes == OUT_BATCH ||
+	    (wsize && out.nframes && out.bytes + out.pending >= wsize))
+		out_flush();
+
+	if (!tv)
+	{
+		gettimeofday(&now, NULL);
+		tv = &now;
+	}
+
+	ts = (uint64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+	epb  = &out.epb[out.nframes];
+	tail = out.tail[out.nframes];
+	iov  = &out.iov[out.nframes * 3];
+
+	epb->type     = PCAPNG_EPB;
+	epb->len      = sizeof(*epb) + len + pad + 4;
+	epb->iface    = 0;
+	epb->ts_high  = ts >> 32;
+	epb->ts_low   = ts & 0xFFFFFFFF;
+	epb->incl_len = len;
+	epb->orig_len = olen;
+
+	/* padding bytes followed by the trailing block length */
+	tail[0] = 0;
+	tail[1] = epb->len;
+
+	iov[0].iov_base = epb;
+	iov[0].iov_len  = sizeof(*epb);
+	iov[1].iov_base = data;
+	iov[1].iov_len  = len;
+	iov[2].iov_base = (uint8_t *)&tail[1] - pad;
+	iov[2].iov_len  = pad + 4;
+
+	out.nframes++;
+	out.pending += epb->len;
+}
+
+
+/*
+ * Drop beacon and/or data frames in the kernel already, before they take up
+ * space in the receive ring, and truncate the remaining ones to snaplen.
+ * Frames too short to carry the radiotap header and frame type are dropped
+ * as well since the loads below run out of bounds for them.
+ */
+int attach_filter(uint16_t snaplen)
+{
+	struct sock_filter code[] = {
+		/* X = le16 radiotap header length */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 3),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 2),
+		BPF_STMT(BPF_ALU | BPF_OR  | BPF_X, 0),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+
+		/* A = frame type */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_IND, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K, FRAMETYPE_MASK),
+
+		/* 0x100 never matches the masked frame type */
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				 filter_data ? FRAMETYPE_DATA : 0x100, 2, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				 filter_beacon ? FRAMETYPE_BEACON : 0x100, 1, 0),
+
+		BPF_STMT(BPF_RET | BPF_K, snaplen),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+
+	struct sock_fprog prog = {
+		.len    = sizeof(code) / sizeof(code[0]),
+		.filter = code
+	};
+
+	return setsockopt(capture_sock, SOL_SOCKET, SO_ATTACH_FILTER,
+					  &prog, sizeof(prog));
+}
+
+int setup_rx_ring(uint32_t size)
+{
+	int ver = TPACKET_V3;
+
+	memset(&rx_req, 0, sizeof(rx_req));
+
+	rx_req.tp_block_size = RX_BLOCK_SIZE;
+	rx_req.tp_block_nr = (size < 2 * RX_BLOCK_SIZE) ? 2 : size / RX_BLOCK_SIZE;
+	rx_req.tp_frame_size = RX_FRAME_SIZE;
+	rx_req.tp_frame_nr = rx_req.tp_block_nr * (RX_BLOCK_SIZE / RX_FRAME_SIZE);
+	rx_req.tp_retire_blk_tov = RX_BLOCK_TIMEOUT;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) ||
+	    setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING, &rx_req, sizeof(rx_req)))
+		return -1;
+
+	rx_map = mmap(NULL, rx_req.tp_block_size * rx_req.tp_block_nr,
+				  PROT_READ | PROT_WRITE, MAP_SHARED, capture_sock, 0);
+
+	if (rx_map == MAP_FAILED)
+	{
+		rx_map = NULL;
+		memset(&rx_req, 0, sizeof(rx_req));
+		setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING, &rx_req, sizeof(rx_req));
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/* handle a received frame, tv is the capture time or NULL for now */
+void handle_frame(uint8_t *data, uint32_t len, uint32_t olen, struct timeval *tv)
+{
+	radiotap_hdr_t *rhdr = (radiotap_hdr_t *)data;
+	struct ringbuf_entry *e;
+	uint32_t sec, usec;
+	uint8_t frametype;
+
+	frames_captured++;
+
+	/* check received frametype, if we should filter it, drop the frame */
+	if (len <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= len)
+	{
+		frames_filtered++;
+		return;
+	}
+
+	frametype = *(uint8_t *)(data + le16(rhdr->it_len));
+
+	if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
+	    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+	{
+		frames_filtered++;
+		return;
+	}
+
+	if (wprefix)
+	{
+		out_frame(data, len, olen, tv);
+	}
+	else if (streaming)
+	{
+		if (tv)
+		{
+			sec  = tv->tv_sec;
+			usec = tv->tv_usec;
+		}
+
+		write_pcap_frame(stdout, tv ? &sec : NULL, tv ? &usec : NULL, len, olen);
+		fwrite(data, 1, len, stdout);
+	}
+	else
+	{
+		e = ringbuf_add(ring);
+		e->olen = olen;
+		e->len = (len > pktcap) ? pktcap : len;
+
+		if (tv)
+		{
+			e->sec  = tv->tv_sec;
+			e->usec = tv->tv_usec;
+		}
+
+		memcpy((void *)e + sizeof(*e), data, e->len);
+	}
+}
+
+/* hand all frames of a filled ring block to handle_frame() */
+void walk_block(struct tpacket_block_desc *bd)
+{
+	struct tpacket3_hdr *h;
+	struct timeval tv;
+	uint32_t i;
+
+	h = (struct tpacket3_hdr *)((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+
+	for (i = 0; i < bd->hdr.bh1.num_pkts; i++)
+	{
+		tv.tv_sec  = h->tp_sec;
+		tv.tv_usec = h->tp_nsec / 1000;
+
+		handle_frame((uint8_t *)h + h->tp_mac, h->tp_snaplen, h->tp_len, &tv);
+
+		h = (struct tpacket3_hdr *)((uint8_t *)h + h->tp_next_offset);
+	}
+}
+
+
 int main(int argc, char **argv)
 {
 	int i, n;
-	struct ringbuf *ring;
 	struct ringbuf_entry *e;
+	struct tpacket_block_desc *bd;
+	struct pollfd pfd;
 	struct sockaddr_ll local = {
 		.sll_family   = AF_PACKET,
 		.sll_protocol = htons(ETH_P_ALL)
 	};
 
-	radiotap_hdr_t *rhdr;
-
-	uint8_t frametype;
 	uint8_t pktbuf[0xFFFF];
 	ssize_t pktlen;
+	size_t caplen;
 
 	FILE *o;
 
 	int opt;
 
 	uint8_t promisc        = 0;
-	uint8_t streaming      = 0;
 	uint8_t foreground     = 0;
-	uint8_t filter_data    = 0;
-	uint8_t filter_beacon  = 0;
-	uint8_t header_written = 0;
 
 	uint32_t ringsz   = 1024 * 1024; /* 1 Mbyte ring buffer */
-	uint16_t pktcap   = 256;		 /* truncate frames after 265KB */
+	uint32_t rxringsz = 2 * 1024 * 1024; /* 2 Mbyte kernel receive ring */
+	uint32_t rx_block = 0;
 
 	const char *output = NULL;
 
 
-	while ((opt = getopt(argc, argv, "i:r:c:o:sfhBD")) != -1)
+	while ((opt = getopt(argc, argv, "i:r:k:c:o:w:C:G:W:z:sfhBD")) != -1)
 	{
 		switch (opt)
 		{
@@ -324,6 +848,10 @@ int main(int argc, char **argv)
 			}
 			break;
 
+		case 'k':
+			rxringsz = atoi(optarg);
+			break;
+
 		case 'c':
 			pktcap = atoi(optarg);
 			if (pktcap <= (sizeof(radiotap_hdr_t) + LEN_IEEE802_11_HDR))
@@ -343,6 +871,31 @@ int main(int argc, char **argv)
 			output = optarg;
 			break;
 
+		case 'w':
+			wprefix = optarg;
+			break;
+
+		case 'C':
+			wsize = atoi(optarg);
+			break;
+
+		case 'G':
+			wtime = atoi(optarg);
+			break;
+
+		case 'W':
+			wfiles = atoi(optarg);
+			break;
+
+		case 'z':
+			if (strcmp(optarg, "zstd") && strcmp(optarg, "lz4"))
+			{
+				msg("Unsupported compression '%s'\n", optarg);
+				return 1;
+			}
+			wcomp = optarg;
+			break;
+
 		case 'B':
 			filter_beacon = 1;
 			break;
@@ -359,7 +912,9 @@ int main(int argc, char **argv)
 			msg(
 				"Usage:\n"
 				"  %s -i {iface} -s [-b] [-d]\n"
-				"  %s -i {iface} -o {file} [-r len] [-c len] [-B] [-D] [-f]\n"
+				"  %s -i {iface} -o {file} [-r len] [-k len] [-c len] [-B] [-D] [-f]\n"
+				"  %s -i {iface} -w {prefix} [-C len] [-G sec] [-W num] [-z comp]\n"
+				"     [-k len] [-c len] [-B] [-D] [-f]\n"
 				"\n"
 				"  -i iface\n"
 				"    Specify interface to use, must be in monitor mode and\n"
@@ -369,9 +924,23 @@ int main(int argc, char **argv)
 				"  -o file\n"
 				"    Write current ringbuffer contents to given output file\n"
 				"    on receipt of SIGUSR1.\n\n"
+				"  -w prefix\n"
+				"    Continuously write pcapng files named prefix.N.pcapng,\n"
+				"    SIGUSR1 starts a new file.\n\n"
+				"  -C len\n"
+				"    Start a new file after given amount of bytes.\n\n"
+				"  -G sec\n"
+				"    Start a new file after given amount of seconds.\n\n"
+				"  -W num\n"
+				"    Only keep the given number of most recent files.\n\n"
+				"  -z zstd|lz4\n"
+				"    Compress files using the given program.\n\n"
 				"  -r len\n"
 				"    Specify the amount of bytes to use for the ringbuffer.\n"
 				"    The default length is %d bytes.\n\n"
+				"  -k len\n"
+				"    Specify the amount of bytes to use for the kernel receive\n"
+				"    ring, 0 disables it. The default length is %d bytes.\n\n"
 				"  -c len\n"
 				"    Truncate captured packets after given amount of bytes.\n"
 				"    The default size limit is %d bytes.\n\n"
@@ -383,21 +952,21 @@ int main(int argc, char **argv)
 				"    Do not daemonize but keep running in foreground.\n\n"
 				"  -h\n"
 				"    Display this help.\n\n",
-				argv[0], argv[0], ringsz, pktcap);
+				argv[0], argv[0], argv[0], ringsz, rxringsz, pktcap);
 
 			return 1;
 		}
 	}
 
-	if (!streaming && !output)
+	if (!streaming && !output && !wprefix)
 	{
 		msg("No output file specified\n");
 		return 1;
 	}
 
-	if (streaming && output)
+	if (streaming + !!output + !!wprefix > 1)
 	{
-		msg("The -s and -o options are exclusive\n");
+		msg("The -s, -o and -w options are exclusive\n");
 		return 1;
 	}
 
@@ -426,6 +995,14 @@ int main(int argc, char **argv)
 		return 6;
 	}
 
+	/* filter and ring are set up before binding to not see any unfiltered
+	 * frames, failing that the capture loop falls back to recvfrom() */
+	if (attach_filter(streaming ? 0xFFFF : pktcap))
+		msg("Unable to attach socket filter: %s\n", strerror(errno));
+
+	if (rxringsz > 0 && setup_rx_ring(rxringsz))
+		msg("Unable to set up receive ring: %s\n", strerror(errno));
+
 	if (bind(capture_sock, (struct sockaddr *)&local, sizeof(local)) == -1)
 	{
 		msg("Unable to bind to interface: %s\n",
@@ -460,16 +1037,39 @@ int main(int argc, char **argv)
 
 		msg("Monitoring interface %s ...\n", ifname);
 
-		if (!(ring = ringbuf_init(ringsz / pktcap, pktcap)))
+		if (wprefix)
 		{
-			msg("Unable to allocate ring buffer: %s\n",
-				strerror(errno));
-			return 5;
+			msg(" * Truncating frames at %d bytes\n", pktcap);
+			msg(" * Writing data to files %s.N.pcapng\n", wprefix);
+
+			if (wsize)
+				msg(" * Rotating files after %u bytes\n", wsize);
+
+			if (wtime)
+				msg(" * Rotating files after %u seconds\n", wtime);
+
+			if (wfiles)
+				msg(" * Keeping %u files\n", wfiles);
+
+			if (wcomp)
+				msg(" * Compressing files with %s\n", wcomp);
+
+			/* a dead compressor must not kill us */
+			signal(SIGPIPE, SIG_IGN);
 		}
+		else
+		{
+			if (!(ring = ringbuf_init(ringsz / pktcap, pktcap)))
+			{
+				msg("Unable to allocate ring buffer: %s\n",
+					strerror(errno));
+				return 5;
+			}
 
-		msg(" * Using %d bytes ringbuffer with %d slots\n", ringsz, ring->len);
-		msg(" * Truncating frames at %d bytes\n", pktcap);
-		msg(" * Dumping data to file %s\n", output);
+			msg(" * Using %d bytes ringbuffer with %d slots\n", ringsz, ring->len);
+			msg(" * Truncating frames at %d bytes\n", pktcap);
+			msg(" * Dumping data to file %s\n", output);
+		}
 
 		signal(SIGUSR1, sig_dump);
 	}
@@ -479,18 +1079,39 @@ int main(int argc, char **argv)
 		msg(" * Streaming data to stdout\n");
 	}
 
+	if (rx_map)
+		msg(" * Using %d bytes kernel receive ring with %d blocks\n",
+			rx_req.tp_block_size * rx_req.tp_block_nr, rx_req.tp_block_nr);
+
 	msg(" * Beacon frames are %sfiltered\n", filter_beacon ? "" : "not ");
 	msg(" * Data frames are %sfiltered\n", filter_data ? "" : "not ");
 
 	signal(SIGINT, sig_teardown);
 	signal(SIGTERM, sig_teardown);
 
+	if (streaming)
+		write_pcap_header(stdout);
+
 	promisc = set_promisc(1);
 
 	/* capture loop */
 	while (1)
 	{
-		if (run_dump)
+		if (run_dump && wprefix)
+		{
+			out_flush();
+			out_close();
+			update_stats();
+
+			msg(" * %d frames captured\n", frames_captured);
+			msg(" * %d frames filtered\n", frames_filtered);
+			msg(" * %llu frames dropped by kernel\n",
+				(unsigned long long)kernel_dropped);
+			msg(" * %d frames dropped on write\n", frames_dropped);
+
+			run_dump = 0;
+		}
+		else if (run_dump)
 		{
 			msg("Dumping ring to %s ...\n", output);
 
@@ -516,8 +1137,12 @@ int main(int argc, char **argv)
 
 				fclose(o);
 
+				update_stats();
+
 				msg(" * %d frames captured\n", frames_captured);
 				msg(" * %d frames filtered\n", frames_filtered);
+				msg(" * %llu frames dropped by kernel\n",
+					(unsigned long long)kernel_dropped);
 				msg(" * %d frames dumped\n", n);
 			}
 
@@ -527,56 +1152,91 @@ int main(int argc, char **argv)
 		{
 			msg("Shutting down ...\n");
 
+			if (wprefix)
+			{
+				out_flush();
+				out_close();
+			}
+
 			if (promisc)
 				set_promisc(0);
 
 			if (ring)
 				ringbuf_free(ring);
 
+			if (rx_map)
+				munmap(rx_map, rx_req.tp_block_size * rx_req.tp_block_nr);
+
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
-		frames_captured++;
+		if (rx_map)
+		{
+			bd = (struct tpacket_block_desc *)
+				(rx_map + rx_block * rx_req.tp_block_size);
 
-		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
+			/* wait for the kernel to retire the next block, signals
+			 * interrupt the poll so dump and stop requests are seen */
+			if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
+			{
+				pfd.fd = capture_sock;
+				pfd.events = POLLIN | POLLERR;
+				pfd.revents = 0;
 
-		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
-		{
-			frames_filtered++;
-			continue;
-		}
+				/* an idle interface retires no blocks, wake up
+				 * in time to rotate the output file */
+				if (!poll(&pfd, 1, wprefix ? out_timeout() : -1))
+					out_rotate();
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+				continue;
+			}
+
+			walk_block(bd);
+
+			if (wprefix)
+				out_flush();
+
+			__sync_synchronize();
+			bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+			rx_block = (rx_block + 1) % rx_req.tp_block_nr;
+
+			if (streaming)
+				fflush(stdout);
 
-		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
-		{
-			frames_filtered++;
 			continue;
 		}
 
-		if (streaming)
+		if (wprefix && wtime)
 		{
-			if (!header_written)
+			pfd.fd = capture_sock;
+			pfd.events = POLLIN | POLLERR;
+			pfd.revents = 0;
+
+			if (!poll(&pfd, 1, out_timeout()))
 			{
-				write_pcap_header(stdout);
-				header_written = 1;
+				out_rotate();
+				continue;
 			}
-
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
 		}
-		else
-		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
-			e->len = (pktlen > pktcap) ? pktcap : pktlen;
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
-		}
+		/* MSG_TRUNC returns the original length of the frame */
+		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), MSG_TRUNC, NULL, 0);
+
+		if (pktlen < 0)
+			continue;
+
+		caplen = ((size_t)pktlen > sizeof(pktbuf)) ? sizeof(pktbuf) : (size_t)pktlen;
+
+		if (!streaming && caplen > pktcap)
+			caplen = pktcap;
+
+		handle_frame(pktbuf, caplen, pktlen, NULL);
+
+		if (wprefix)
+			out_flush();
+
+		if (streaming)
+			fflush(stdout);
 	}
 
 	return 0;
@@ -15,6 +15,42 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <ctype.h>
+#include <limits.h>
+
+
+enum {
+	QUERY_NEW,
+	QUERY_RUNNING,
+	QUERY_DONE,
+	QUERY_FAILED,
+	QUERY_TIMEOUT
+};
+
+struct query {
+	char *name;
+	int state;
+	time_t cached;
+	int naddr;
+	char (*addr)[INET6_ADDRSTRLEN];
+	struct timespec deadline;
+};
+
+static struct addrinfo hints = {
+	.ai_family   = AF_UNSPEC,
+	.ai_socktype = SOCK_STREAM,
+	.ai_protocol = IPPROTO_TCP,
+	.ai_flags    = 0
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static struct query *queries;
+static int nqueries;
 
 
 static void abort_query(int sig)
@@ -22,6 +58,310 @@ static void abort_query(int sig)
 	exit(1);
 }
 
+static int resolve(const char *name, char (**addrs)[INET6_ADDRSTRLEN])
+{
+	struct addrinfo *res, *rp;
+	void *addr;
+	int n = 0;
+
+	if (getaddrinfo(name, NULL, &hints, &res))
+		return -1;
+
+	for (rp = res; rp != NULL; rp = rp->ai_next)
+		n++;
+
+	*addrs = calloc(n ? n : 1, INET6_ADDRSTRLEN);
+
+	for (rp = res, n = 0; *addrs && rp != NULL; rp = rp->ai_next)
+	{
+		addr = (rp->ai_family == AF_INET)
+			? (void *)&((struct sockaddr_in *)rp->ai_addr)->sin_addr
+			: (void *)&((struct sockaddr_in6 *)rp->ai_addr)->sin6_addr
+		;
+
+		if (inet_ntop(rp->ai_family, addr, (*addrs)[n], INET6_ADDRSTRLEN - 1))
+			n++;
+	}
+
+	freeaddrinfo(res);
+
+	return *addrs ? n : -1;
+}
+
+/* a thread per query, a query which timed out keeps its thread until the
+ * blocking getaddrinfo() returns but no longer counts as running */
+static void *resolve_thread(void *arg)
+{
+	struct query *q = arg;
+	char (*addrs)[INET6_ADDRSTRLEN] = NULL;
+	int n;
+
+	n = resolve(q->name, &addrs);
+
+	pthread_mutex_lock(&lock);
+
+	if (q->state == QUERY_RUNNING)
+	{
+		q->state = (n > 0) ? QUERY_DONE : QUERY_FAILED;
+		q->addr = addrs;
+		q->naddr = n;
+		addrs = NULL;
+	}
+
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&lock);
+
+	free(addrs);
+	return NULL;
+}
+
+static void add_query(const char *name)
+{
+	struct query *q;
+	int i;
+
+	for (i = 0; i < nqueries; i++)
+		if (!strcmp(queries[i].name, name))
+			return;
+
+	if (!(nqueries % 64))
+	{
+		q = realloc(queries, (nqueries + 64) * sizeof(*q));
+
+		if (!q)
+			exit(255);
+
+		queries = q;
+	}
+
+	q = &queries[nqueries++];
+	memset(q, 0, sizeof(*q));
+	q->name = strdup(name);
+
+	if (!q->name)
+		exit(255);
+}
+
+static void read_queries(FILE *f)
+{
+	char line[256], *p, *e;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		for (p = line; *p; p = e)
+		{
+			while (isspace((unsigned char)*p))
+				p++;
+
+			for (e = p; *e && !isspace((unsigned char)*e); e++);
+
+			if (e == p)
+				break;
+
+			if (*e)
+				*e++ = 0;
+
+			add_query(p);
+		}
+	}
+}
+
+/*
+ * The cache holds one "expiry family name address" line per address,
+ * family being the -4/-6 option in effect (0 for none). getaddrinfo()
+ * does not report record TTLs, entries are kept for the -T lifetime.
+ */
+static void load_cache(const char *path)
+{
+	char line[512], name[256], addr[INET6_ADDRSTRLEN];
+	long long expiry;
+	int family, i;
+	struct query *q;
+	FILE *f;
+
+	if (!(f = fopen(path, "r")))
+		return;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "%lld %d %255s %45s", &expiry, &family, name, addr) != 4)
+			continue;
+
+		if (family != hints.ai_family || expiry <= time(NULL))
+			continue;
+
+		for (i = 0, q = queries; i < nqueries; i++, q++)
+		{
+			if (strcmp(q->name, name) || (q->state != QUERY_NEW && !q->cached))
+				continue;
+
+			if (!(q->naddr % 8))
+			{
+				void *a = realloc(q->addr, (q->naddr + 8) * INET6_ADDRSTRLEN);
+
+				if (!a)
+					break;
+
+				q->addr = a;
+			}
+
+			strcpy(q->addr[q->naddr++], addr);
+			q->state = QUERY_DONE;
+			q->cached = expiry;
+			break;
+		}
+	}
+
+	fclose(f);
+}
+
+static void save_cache(const char *path, int ttl)
+{
+	char line[512], name[256], tmp[PATH_MAX];
+	long long expiry;
+	int family, i, j;
+	struct query *q;
+	FILE *in, *out;
+
+	/* a truncated name would be renamed over the wrong file */
+	if (snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid()) >= (int)sizeof(tmp))
+		return;
+
+	if (!(out = fopen(tmp, "w")))
+		return;
+
+	/* keep live entries of other names and other families */
+	if ((in = fopen(path, "r")) != NULL)
+	{
+		while (fgets(line, sizeof(line), in))
+		{
+			if (sscanf(line, "%lld %d %255s", &expiry, &family, name) != 3)
+				continue;
+
+			if (expiry <= time(NULL))
+				continue;
+
+			if (family == hints.ai_family)
+			{
+				for (i = 0; i < nqueries; i++)
+					if (queries[i].state == QUERY_DONE && !strcmp(queries[i].name, name))
+						break;
+
+				if (i < nqueries)
+					continue;
+			}
+
+			fputs(line, out);
+		}
+
+		fclose(in);
+	}
+
+	for (i = 0, q = queries; i < nqueries; i++, q++)
+	{
+		if (q->state != QUERY_DONE)
+			continue;
+
+		for (j = 0; j < q->naddr; j++)
+			fprintf(out, "%lld %d %s %s\n",
+				q->cached ? (long long)q->cached : (long long)time(NULL) + ttl,
+				hints.ai_family, q->name, q->addr[j]);
+	}
+
+	if (fclose(out) || rename(tmp, path))
+		unlink(tmp);
+}
+
+static int ts_before(const struct timespec *a, const struct timespec *b)
+{
+	return (a->tv_sec < b->tv_sec) ||
+		(a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static int run_batch(int timeout, int jobs)
+{
+	struct timespec now, wait;
+	struct query *q;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int next = 0, printed = 0, running = 0, rv = 0, i, j;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, 64 * 1024);
+
+	pthread_mutex_lock(&lock);
+
+	while (printed < nqueries)
+	{
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		/* expire queries running for too long and find the next deadline */
+		for (i = printed, running = 0; i < next; i++)
+		{
+			q = &queries[i];
+
+			if (q->state != QUERY_RUNNING)
+				continue;
+
+			if (!ts_before(&now, &q->deadline))
+			{
+				q->state = QUERY_TIMEOUT;
+				continue;
+			}
+
+			if (!running++ || ts_before(&q->deadline, &wait))
+				wait = q->deadline;
+		}
+
+		/* start queries up to the concurrency limit */
+		for (; next < nqueries && running < jobs; next++)
+		{
+			q = &queries[next];
+
+			if (q->state != QUERY_NEW)
+				continue;
+
+			q->state = QUERY_RUNNING;
+			q->deadline = now;
+			q->deadline.tv_sec += timeout;
+
+			if (pthread_create(&tid, &attr, resolve_thread, q))
+			{
+				q->state = QUERY_FAILED;
+				continue;
+			}
+
+			if (!running++ || ts_before(&q->deadline, &wait))
+				wait = q->deadline;
+		}
+
+		/* print finished queries in input order */
+		for (; printed < next && queries[printed].state > QUERY_RUNNING; printed++)
+		{
+			q = &queries[printed];
+
+			if (q->state != QUERY_DONE)
+			{
+				rv = 2;
+				continue;
+			}
+
+			for (j = 0; j < q->naddr; j++)
+				printf("%s %s\n", q->name, q->addr[j]);
+		}
+
+		fflush(stdout);
+
+		if (running)
+			pthread_cond_timedwait(&cond, &lock, &wait);
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	return rv;
+}
+
 static void show_usage(void)
 {
 	printf("Usage:\n");
@@ -29,25 +369,29 @@ static void show_usage(void)
 	printf("	resolveip [-t timeout] hostname\n");
 	printf("	resolveip -4 [-t timeout] hostname\n");
 	printf("	resolveip -6 [-t timeout] hostname\n");
+	printf("	resolveip -b [-4|-6] [-t timeout] [-j jobs] [-c cachefile [-T ttl]] [hostname ...]\n");
+	printf("\n");
+	printf("	In batch mode (-b) host names are read from the arguments or, if\n");
+	printf("	none are given, from stdin and up to jobs (default 8) of them are\n");
+	printf("	resolved in parallel. Output lines are \"hostname address\". The\n");
+	printf("	cachefile keeps results for ttl (default 300) seconds.\n");
 	exit(255);
 }
 
 int main(int argc, char **argv)
 {
 	int timeout = 3;
-	int opt;
+	int batch = 0;
+	int jobs = 8;
+	int ttl = 300;
+	int opt, rv;
+	const char *cache = NULL;
 	char ipaddr[INET6_ADDRSTRLEN];
 	void *addr;
 	struct addrinfo *res, *rp;
 	struct sigaction sa = {	.sa_handler = &abort_query };
-	struct addrinfo hints = {
-		.ai_family   = AF_UNSPEC,
-		.ai_socktype = SOCK_STREAM,
-		.ai_protocol = IPPROTO_TCP,
-		.ai_flags    = 0
-	};
-
-	while ((opt = getopt(argc, argv, "46t:h")) > -1)
+
+	while ((opt = getopt(argc, argv, "46t:bj:c:T:h")) > -1)
 	{
 		switch ((char)opt)
 		{
@@ -65,12 +409,51 @@ int main(int argc, char **argv)
 					show_usage();
 				break;
 
+			case 'b':
+				batch = 1;
+				break;
+
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs <= 0)
+					show_usage();
+				break;
+
+			case 'c':
+				cache = optarg;
+				break;
+
+			case 'T':
+				ttl = atoi(optarg);
+				if (ttl <= 0)
+					show_usage();
+				break;
+
 			case 'h':
 				show_usage();
 				break;
 		}
 	}
 
+	if (batch)
+	{
+		if (argv[optind])
+			while (argv[optind])
+				add_query(argv[optind++]);
+		else
+			read_queries(stdin);
+
+		if (cache)
+			load_cache(cache);
+
+		rv = run_batch(timeout, jobs);
+
+		if (cache)
+			save_cache(cache, ttl);
+
+		exit(rv);
+	}
+
 	if (!argv[optind])
 		show_usage();
 
@@ -1,23 +1,39 @@
 #include <sys/resource.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_link.h>
 
 #include <stdint.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <byteswap.h>
+#include <endian.h>
 #include <errno.h>
 #include <unistd.h>
 
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
+#include <libubox/uloop.h>
+
 #include "ucode/module.h"
 
 #define err_return_int(err, ...) do { set_error(err, __VA_ARGS__); return -1; } while(0)
 #define err_return(err, ...) do { set_error(err, __VA_ARGS__); return NULL; } while(0)
 #define TRUE ucv_boolean_new(true)
 
+#ifndef ENOTSUPP
+#define ENOTSUPP 524
+#endif
+
+#define BATCH_SIZE 256
+#define PERF_BUFFER_PAGES 8
+
 static uc_resource_type_t *module_type, *map_type, *map_iter_type, *program_type;
+static uc_resource_type_t *ringbuf_type, *map_mmap_type, *codec_type, *link_type;
 static uc_value_t *registry;
 static uc_vm_t *debug_vm;
 
@@ -31,9 +47,80 @@ struct uc_bpf_fd {
 	bool close;
 };
 
+enum uc_bpf_field_type {
+	FIELD_UINT,
+	FIELD_SINT,
+	FIELD_BOOL,
+	FIELD_IPV4,
+	FIELD_IPV6,
+	FIELD_MAC,
+	FIELD_BYTES,
+	FIELD_STRING,
+};
+
+struct uc_bpf_codec_field {
+	char *name;
+	enum uc_bpf_field_type type;
+	unsigned int offset, size;
+	bool swap;
+};
+
+struct uc_bpf_codec {
+	unsigned int size, n_fields;
+	struct uc_bpf_codec_field fields[];
+};
+
 struct uc_bpf_map {
 	struct uc_bpf_fd fd; /* must be first */
 	unsigned int key_size, val_size;
+	unsigned int max_entries, map_flags;
+	enum bpf_map_type type;
+	unsigned int no_batch; /* UC_BPF_BATCH_* ops the kernel refused */
+
+	/* scratch buffers for single element operations */
+	void *key_buf, *val_buf;
+
+	uc_value_t *key_codec_res, *val_codec_res;
+	struct uc_bpf_codec *key_codec, *val_codec;
+};
+
+struct uc_bpf_map_mmap {
+	void *data;
+	size_t size;
+	unsigned int stride, val_size, max_entries;
+	bool writable;
+};
+
+struct uc_bpf_batch {
+	void *keys, *vals, *token;
+	unsigned int val_size, token_size;
+	__u32 size, count;
+	bool started, done;
+	bool slow; /* token is the last key rather than a kernel batch token */
+};
+
+enum {
+	UC_BPF_BATCH_LOOKUP		= (1 << 0),
+	UC_BPF_BATCH_LOOKUP_DELETE	= (1 << 1),
+	UC_BPF_BATCH_UPDATE		= (1 << 2),
+	UC_BPF_BATCH_DELETE		= (1 << 3),
+};
+
+/* cursors returned by get_batch() start with the kind of token they carry */
+enum {
+	UC_BPF_CURSOR_BATCH,
+	UC_BPF_CURSOR_KEY,
+};
+
+struct uc_bpf_ringbuf {
+	struct uloop_fd fd;
+	uc_vm_t *vm;
+	size_t registry_index;
+	struct ring_buffer *rb;
+	struct perf_buffer *pb;
+	bool error, consuming, free_pending;
+
+	uint64_t records, lost, wakeups;
 };
 
 struct uc_bpf_map_iter {
@@ -187,16 +274,44 @@ uc_bpf_open_module(uc_vm_t *vm, size_t nargs)
 	return uc_resource_new(module_type, obj);
 }
 
+static bool
+uc_bpf_map_is_percpu(struct uc_bpf_map *map)
+{
+	switch (map->type) {
+	case BPF_MAP_TYPE_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_ARRAY:
+	case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* per-cpu maps return the values of all possible cpus, each padded to 8 bytes */
+static unsigned int
+uc_bpf_map_batch_val_size(struct uc_bpf_map *map)
+{
+	if (!uc_bpf_map_is_percpu(map))
+		return map->val_size;
+
+	return ((map->val_size + 7) & ~7) * libbpf_num_possible_cpus();
+}
+
 static uc_value_t *
-uc_bpf_map_create(int fd, unsigned int key_size, unsigned int val_size, bool close)
+uc_bpf_map_create(int fd, const struct bpf_map_info *info, bool close)
 {
 	struct uc_bpf_map *uc_map;
 
 	uc_map = xalloc(sizeof(*uc_map));
 	uc_map->fd.fd = fd;
-	uc_map->key_size = key_size;
-	uc_map->val_size = val_size;
+	uc_map->key_size = info->key_size;
+	uc_map->val_size = info->value_size;
+	uc_map->max_entries = info->max_entries;
+	uc_map->map_flags = info->map_flags;
+	uc_map->type = info->type;
 	uc_map->fd.close = close;
+	uc_map->key_buf = xalloc(uc_map->key_size);
+	uc_map->val_buf = xalloc(uc_bpf_map_batch_val_size(uc_map));
 
 	return uc_resource_new(map_type, uc_map);
 }
@@ -223,7 +338,7 @@ uc_bpf_open_map(uc_vm_t *vm, size_t nargs)
 		err_return(errno, NULL);
 	}
 
-	return uc_bpf_map_create(fd, info.key_size, info.value_size, true);
+	return uc_bpf_map_create(fd, &info, true);
 }
 
 static uc_value_t *
@@ -269,6 +384,7 @@ static uc_value_t *
 uc_bpf_module_get_map(uc_vm_t *vm, size_t nargs)
 {
 	struct bpf_object *obj = uc_fn_thisval("bpf.module");
+	struct bpf_map_info info = {};
 	struct bpf_map *map;
 	uc_value_t *name = uc_fn_arg(0);
 	int fd;
@@ -284,7 +400,13 @@ uc_bpf_module_get_map(uc_vm_t *vm, size_t nargs)
 	if (fd < 0)
 		err_return(EINVAL, NULL);
 
-	return uc_bpf_map_create(fd, bpf_map__key_size(map), bpf_map__value_size(map), false);
+	info.type = bpf_map__type(map);
+	info.key_size = bpf_map__key_size(map);
+	info.value_size = bpf_map__value_size(map);
+	info.max_entries = bpf_map__max_entries(map);
+	info.map_flags = bpf_map__map_flags(map);
+
+	return uc_bpf_map_create(fd, &info, false);
 }
 
 static uc_value_t *
@@ -361,25 +483,455 @@ uc_bpf_map_arg(uc_value_t *val, const char *kind, unsigned int size)
 	err_return(EINVAL, "%s size mismatch (expected: %d)", kind, size);
 }
 
+/* host byte order unless suffixed with "be" or "le" */
+static int
+uc_bpf_codec_field_parse(struct uc_bpf_codec_field *f, const char *type,
+			 unsigned int *align)
+{
+	static const struct {
+		const char *name;
+		enum uc_bpf_field_type type;
+		unsigned int size, align;
+	} types[] = {
+		{ "bool", FIELD_BOOL, 1, 1 },
+		{ "ipv4", FIELD_IPV4, 4, 4 },
+		{ "ipv6", FIELD_IPV6, 16, 4 },
+		{ "mac", FIELD_MAC, 6, 1 },
+	};
+	unsigned long val;
+	unsigned int i;
+	char *end;
+
+	for (i = 0; i < ARRAY_SIZE(types); i++) {
+		if (strcmp(type, types[i].name) != 0)
+			continue;
+
+		f->type = types[i].type;
+		f->size = types[i].size;
+		*align = types[i].align;
+		return 0;
+	}
+
+	if (!strncmp(type, "bytes:", 6) || !strncmp(type, "string:", 7)) {
+		f->type = type[0] == 'b' ? FIELD_BYTES : FIELD_STRING;
+		val = strtoul(strchr(type, ':') + 1, &end, 10);
+		if (*end || !val || val > 65536)
+			return -1;
+
+		f->size = val;
+		*align = 1;
+		return 0;
+	}
+
+	if ((type[0] != 'u' && type[0] != 's') || !isdigit(type[1]))
+		return -1;
+
+	f->type = type[0] == 'u' ? FIELD_UINT : FIELD_SINT;
+	val = strtoul(type + 1, &end, 10);
+	if (val != 8 && val != 16 && val != 32 && val != 64)
+		return -1;
+
+	f->size = *align = val / 8;
+	if (!*end)
+		return 0;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	if (!strcmp(end, "be"))
+		f->swap = f->size > 1;
+	else if (strcmp(end, "le") != 0)
+		return -1;
+#else
+	if (!strcmp(end, "le"))
+		f->swap = f->size > 1;
+	else if (strcmp(end, "be") != 0)
+		return -1;
+#endif
+
+	return 0;
+}
+
+static struct uc_bpf_codec *
+uc_bpf_codec_compile(uc_value_t *fields, bool packed)
+{
+	struct uc_bpf_codec *codec;
+	unsigned int offset = 0, max_align = 1, align, i = 0;
+
+	if (ucv_type(fields) != UC_OBJECT || !ucv_object_length(fields))
+		err_return(EINVAL, "fields");
+
+	codec = xalloc(sizeof(*codec) + ucv_object_length(fields) * sizeof(codec->fields[0]));
+	ucv_object_foreach(fields, name, type) {
+		struct uc_bpf_codec_field *f = &codec->fields[i++];
+
+		codec->n_fields = i;
+		f->name = xstrdup(name);
+		if (ucv_type(type) != UC_STRING ||
+		    uc_bpf_codec_field_parse(f, ucv_string_get(type), &align)) {
+			set_error(EINVAL, "field %s type", name);
+			goto error;
+		}
+
+		if (packed)
+			align = 1;
+
+		offset = (offset + align - 1) & ~(align - 1);
+		f->offset = offset;
+		offset += f->size;
+		if (align > max_align)
+			max_align = align;
+	}
+
+	codec->size = (offset + max_align - 1) & ~(max_align - 1);
+
+	return codec;
+
+error:
+	for (i = 0; i < codec->n_fields; i++)
+		free(codec->fields[i].name);
+	free(codec);
+	return NULL;
+}
+
+static uint64_t
+uc_bpf_codec_get_int(const struct uc_bpf_codec_field *f, const uint8_t *data)
+{
+	uint64_t val;
+	uint32_t v32;
+	uint16_t v16;
+
+	switch (f->size) {
+	case 1:
+		val = data[0];
+		if (f->type == FIELD_SINT)
+			val = (int8_t)val;
+		break;
+	case 2:
+		memcpy(&v16, data, sizeof(v16));
+		if (f->swap)
+			v16 = bswap_16(v16);
+		val = f->type == FIELD_SINT ? (uint64_t)(int16_t)v16 : v16;
+		break;
+	case 4:
+		memcpy(&v32, data, sizeof(v32));
+		if (f->swap)
+			v32 = bswap_32(v32);
+		val = f->type == FIELD_SINT ? (uint64_t)(int32_t)v32 : v32;
+		break;
+	default:
+		memcpy(&val, data, sizeof(val));
+		if (f->swap)
+			val = bswap_64(val);
+		break;
+	}
+
+	return val;
+}
+
+static void
+uc_bpf_codec_set_int(const struct uc_bpf_codec_field *f, uint8_t *data, uint64_t val)
+{
+	uint32_t v32 = val;
+	uint16_t v16 = val;
+
+	switch (f->size) {
+	case 1:
+		data[0] = val;
+		break;
+	case 2:
+		if (f->swap)
+			v16 = bswap_16(v16);
+		memcpy(data, &v16, sizeof(v16));
+		break;
+	case 4:
+		if (f->swap)
+			v32 = bswap_32(v32);
+		memcpy(data, &v32, sizeof(v32));
+		break;
+	default:
+		if (f->swap)
+			val = bswap_64(val);
+		memcpy(data, &val, sizeof(val));
+		break;
+	}
+}
+
+/* fields missing from the object are left zeroed */
+static int
+uc_bpf_codec_pack(struct uc_bpf_codec *codec, uc_value_t *obj, void *buf)
+{
+	unsigned int i;
+
+	memset(buf, 0, codec->size);
+	for (i = 0; i < codec->n_fields; i++) {
+		struct uc_bpf_codec_field *f = &codec->fields[i];
+		uint8_t *data = (uint8_t *)buf + f->offset;
+		uc_value_t *val = ucv_object_get(obj, f->name, NULL);
+		uint64_t intval;
+		int64_t sval;
+
+		if (!val)
+			continue;
+
+		switch (f->type) {
+		case FIELD_UINT:
+		case FIELD_SINT:
+			if (ucv_type(val) != UC_INTEGER)
+				goto error;
+
+			errno = 0;
+			sval = ucv_int64_get(val);
+			intval = errno ? ucv_uint64_get(val) : (uint64_t)sval;
+			uc_bpf_codec_set_int(f, data, intval);
+			break;
+		case FIELD_BOOL:
+			data[0] = ucv_is_truish(val);
+			break;
+		case FIELD_IPV4:
+		case FIELD_IPV6:
+			if (ucv_type(val) != UC_STRING ||
+			    inet_pton(f->type == FIELD_IPV4 ? AF_INET : AF_INET6,
+				      ucv_string_get(val), data) != 1)
+				goto error;
+			break;
+		case FIELD_MAC:
+			if (ucv_type(val) != UC_STRING ||
+			    sscanf(ucv_string_get(val), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+				   &data[0], &data[1], &data[2],
+				   &data[3], &data[4], &data[5]) != 6)
+				goto error;
+			break;
+		case FIELD_BYTES:
+		case FIELD_STRING:
+			if (ucv_type(val) != UC_STRING ||
+			    ucv_string_length(val) > f->size)
+				goto error;
+
+			memcpy(data, ucv_string_get(val), ucv_string_length(val));
+			break;
+		}
+	}
+
+	return 0;
+
+error:
+	err_return_int(EINVAL, "field %s", codec->fields[i].name);
+}
+
+/* for per-cpu data, integer fields are summed up over all cpus and the
+ * other fields are taken from the first one */
+static uc_value_t *
+uc_bpf_codec_unpack(uc_vm_t *vm, struct uc_bpf_codec *codec, const void *buf,
+		    unsigned int ncpus, unsigned int stride)
+{
+	char addr[INET6_ADDRSTRLEN];
+	uc_value_t *rv, *val;
+	unsigned int i, cpu;
+
+	rv = ucv_object_new(vm);
+	for (i = 0; i < codec->n_fields; i++) {
+		struct uc_bpf_codec_field *f = &codec->fields[i];
+		const uint8_t *data = (const uint8_t *)buf + f->offset;
+		uint64_t intval = 0;
+
+		switch (f->type) {
+		case FIELD_UINT:
+		case FIELD_SINT:
+			for (cpu = 0; cpu < ncpus; cpu++)
+				intval += uc_bpf_codec_get_int(f, data + cpu * stride);
+
+			if (f->type == FIELD_SINT)
+				val = ucv_int64_new((int64_t)intval);
+			else
+				val = ucv_uint64_new(intval);
+			break;
+		case FIELD_BOOL:
+			val = ucv_boolean_new(data[0]);
+			break;
+		case FIELD_IPV4:
+		case FIELD_IPV6:
+			inet_ntop(f->type == FIELD_IPV4 ? AF_INET : AF_INET6,
+				  data, addr, sizeof(addr));
+			val = ucv_string_new(addr);
+			break;
+		case FIELD_MAC:
+			snprintf(addr, sizeof(addr), "%02x:%02x:%02x:%02x:%02x:%02x",
+				 data[0], data[1], data[2], data[3], data[4], data[5]);
+			val = ucv_string_new(addr);
+			break;
+		case FIELD_STRING:
+			val = ucv_string_new_length((const char *)data,
+						    strnlen((const char *)data, f->size));
+			break;
+		default:
+			val = ucv_string_new_length((const char *)data, f->size);
+			break;
+		}
+
+		ucv_object_add(rv, f->name, val);
+	}
+
+	return rv;
+}
+
+static struct uc_bpf_codec *
+uc_bpf_codec_get(uc_value_t *val)
+{
+	void **ptr = ucv_resource_dataptr(val, "bpf.codec");
+
+	return ptr ? *ptr : NULL;
+}
+
+static uc_value_t *
+uc_bpf_codec_new(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *fields = uc_fn_arg(0);
+	uc_value_t *packed = uc_fn_arg(1);
+	struct uc_bpf_codec *codec;
+
+	codec = uc_bpf_codec_compile(fields, ucv_is_truish(packed));
+	if (!codec)
+		return NULL;
+
+	return uc_resource_new(codec_type, codec);
+}
+
+static uc_value_t *
+uc_bpf_codec_pack_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_codec *codec = uc_fn_thisval("bpf.codec");
+	uc_value_t *obj = uc_fn_arg(0);
+	uc_value_t *rv;
+	void *buf;
+
+	if (!codec || ucv_type(obj) != UC_OBJECT)
+		err_return(EINVAL, NULL);
+
+	buf = xalloc(codec->size);
+	if (uc_bpf_codec_pack(codec, obj, buf))
+		rv = NULL;
+	else
+		rv = ucv_string_new_length(buf, codec->size);
+	free(buf);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_codec_unpack_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_codec *codec = uc_fn_thisval("bpf.codec");
+	uc_value_t *data = uc_fn_arg(0);
+
+	if (!codec || ucv_type(data) != UC_STRING)
+		err_return(EINVAL, NULL);
+
+	if (ucv_string_length(data) != codec->size)
+		err_return(EINVAL, "size mismatch (expected: %d)", codec->size);
+
+	return uc_bpf_codec_unpack(vm, codec, ucv_string_get(data), 1, 0);
+}
+
+static uc_value_t *
+uc_bpf_codec_size(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_codec *codec = uc_fn_thisval("bpf.codec");
+
+	if (!codec)
+		err_return(EINVAL, NULL);
+
+	return ucv_int64_new(codec->size);
+}
+
+/* Converts a key or value argument into map memory. Objects are packed
+ * with the codec set on the map, anything else is handled by
+ * uc_bpf_map_arg(). */
+static int
+uc_bpf_map_pack(struct uc_bpf_map *map, bool is_key, uc_value_t *val,
+		void *buf, unsigned int size)
+{
+	struct uc_bpf_codec *codec = is_key ? map->key_codec : map->val_codec;
+	void *data;
+
+	if (codec && ucv_type(val) == UC_OBJECT) {
+		memset(buf, 0, size);
+		return uc_bpf_codec_pack(codec, val, buf);
+	}
+
+	data = uc_bpf_map_arg(val, is_key ? "key" : "value", size);
+	if (!data)
+		return -1;
+
+	memcpy(buf, data, size);
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_map_unpack(uc_vm_t *vm, struct uc_bpf_map *map, bool is_key,
+		  const void *data, unsigned int size)
+{
+	struct uc_bpf_codec *codec = is_key ? map->key_codec : map->val_codec;
+	unsigned int stride = (map->val_size + 7) & ~7;
+
+	if (!codec)
+		return ucv_string_new_length(data, size);
+
+	if (is_key || !uc_bpf_map_is_percpu(map) || size < stride)
+		return uc_bpf_codec_unpack(vm, codec, data, 1, 0);
+
+	return uc_bpf_codec_unpack(vm, codec, data, size / stride, stride);
+}
+
+static uc_value_t *
+uc_bpf_map_set_codec(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_key = uc_fn_arg(0);
+	uc_value_t *a_val = uc_fn_arg(1);
+	struct uc_bpf_codec *key = NULL, *val = NULL;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (a_key && !(key = uc_bpf_codec_get(a_key)))
+		err_return(EINVAL, "key codec");
+
+	if (a_val && !(val = uc_bpf_codec_get(a_val)))
+		err_return(EINVAL, "value codec");
+
+	if (key && key->size != map->key_size)
+		err_return(EINVAL, "key codec size mismatch (expected: %d)", map->key_size);
+
+	if (val && val->size != map->val_size)
+		err_return(EINVAL, "value codec size mismatch (expected: %d)", map->val_size);
+
+	ucv_put(map->key_codec_res);
+	ucv_put(map->val_codec_res);
+	map->key_codec_res = ucv_get(a_key);
+	map->val_codec_res = ucv_get(a_val);
+	map->key_codec = key;
+	map->val_codec = val;
+
+	return TRUE;
+}
+
 static uc_value_t *
 uc_bpf_map_get(uc_vm_t *vm, size_t nargs)
 {
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *a_key = uc_fn_arg(0);
-	void *key, *val;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = uc_bpf_map_arg(a_key, "key", map->key_size);
-	if (!key)
+	if (uc_bpf_map_pack(map, true, a_key, map->key_buf, map->key_size))
 		return NULL;
 
-	val = alloca(map->val_size);
-	if (bpf_map_lookup_elem(map->fd.fd, key, val))
+	if (bpf_map_lookup_elem(map->fd.fd, map->key_buf, map->val_buf))
 		return NULL;
 
-	return ucv_string_new_length(val, map->val_size);
+	return uc_bpf_map_unpack(vm, map, false, map->val_buf,
+				 map->val_codec ? uc_bpf_map_batch_val_size(map) : map->val_size);
 }
 
 static uc_value_t *
@@ -390,17 +942,16 @@ uc_bpf_map_set(uc_vm_t *vm, size_t nargs)
 	uc_value_t *a_val = uc_fn_arg(1);
 	uc_value_t *a_flags = uc_fn_arg(2);
 	uint64_t flags;
-	void *key, *val;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = uc_bpf_map_arg(a_key, "key", map->key_size);
-	if (!key)
+	if (uc_bpf_map_pack(map, true, a_key, map->key_buf, map->key_size))
 		return NULL;
 
-	val = uc_bpf_map_arg(a_val, "value", map->val_size);
-	if (!val)
+	/* per-cpu maps: the value is set on the first cpu only */
+	memset(map->val_buf, 0, uc_bpf_map_batch_val_size(map));
+	if (uc_bpf_map_pack(map, false, a_val, map->val_buf, map->val_size))
 		return NULL;
 
 	if (!a_flags)
@@ -410,10 +961,10 @@ uc_bpf_map_set(uc_vm_t *vm, size_t nargs)
 	else
 		flags = ucv_int64_get(a_flags);
 
-	if (bpf_map_update_elem(map->fd.fd, key, val, flags))
+	if (bpf_map_update_elem(map->fd.fd, map->key_buf, map->val_buf, flags))
 		return NULL;
 
-	return ucv_string_new_length(val, map->val_size);
+	return uc_bpf_map_unpack(vm, map, false, map->val_buf, map->val_size);
 }
 
 static uc_value_t *
@@ -422,27 +973,172 @@ uc_bpf_map_delete(uc_vm_t *vm, size_t nargs)
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *a_key = uc_fn_arg(0);
 	uc_value_t *a_return = uc_fn_arg(1);
-	void *key, *val = NULL;
 	int ret;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = uc_bpf_map_arg(a_key, "key", map->key_size);
-	if (!key)
+	if (uc_bpf_map_pack(map, true, a_key, map->key_buf, map->key_size))
 		return NULL;
 
 	if (!ucv_is_truish(a_return)) {
-		ret = bpf_map_delete_elem(map->fd.fd, key);
+		ret = bpf_map_delete_elem(map->fd.fd, map->key_buf);
 
 		return ucv_boolean_new(ret == 0);
 	}
 
-	val = alloca(map->val_size);
-	if (bpf_map_lookup_and_delete_elem(map->fd.fd, key, val))
+	if (bpf_map_lookup_and_delete_elem(map->fd.fd, map->key_buf, map->val_buf))
 		return NULL;
 
-	return ucv_string_new_length(val, map->val_size);
+	return uc_bpf_map_unpack(vm, map, false, map->val_buf,
+				 map->val_codec ? uc_bpf_map_batch_val_size(map) : map->val_size);
+}
+
+/* a batch never needs to hold more than the whole map, which also keeps the
+ * buffer sizes from overflowing */
+static __u32
+uc_bpf_batch_clamp(struct uc_bpf_map *map, struct uc_bpf_batch *b, size_t size)
+{
+	size_t elem_size = map->key_size > b->val_size ? map->key_size : b->val_size;
+
+	if (map->max_entries && size > map->max_entries)
+		size = map->max_entries;
+
+	if (elem_size && size > SIZE_MAX / elem_size)
+		size = SIZE_MAX / elem_size;
+
+	return size ? size : 1;
+}
+
+static void
+uc_bpf_batch_init(struct uc_bpf_map *map, struct uc_bpf_batch *b, __u32 size)
+{
+	memset(b, 0, sizeof(*b));
+	b->val_size = uc_bpf_map_batch_val_size(map);
+	b->size = uc_bpf_batch_clamp(map, b, size ? size : BATCH_SIZE);
+	b->keys = xalloc((size_t)b->size * map->key_size);
+	b->vals = xalloc((size_t)b->size * b->val_size);
+	b->token_size = map->key_size < sizeof(__u32) ? sizeof(__u32) : map->key_size;
+	b->token = xalloc(b->token_size);
+}
+
+static void
+uc_bpf_batch_free(struct uc_bpf_batch *b)
+{
+	free(b->keys);
+	free(b->vals);
+	free(b->token);
+}
+
+static bool
+uc_bpf_batch_unsupported(int err)
+{
+	return err == EINVAL || err == ENOTSUPP || err == EOPNOTSUPP;
+}
+
+/* fallback for kernels or map types without batch operations, the token
+ * holds the last key returned */
+static int
+uc_bpf_batch_next_slow(struct uc_bpf_map *map, struct uc_bpf_batch *b, bool delete)
+{
+	uint8_t *key = b->keys, *val = b->vals;
+
+	while (b->count < b->size) {
+		if (bpf_map_get_next_key(map->fd.fd, b->started ? b->token : NULL, key)) {
+			b->done = true;
+			break;
+		}
+
+		memcpy(b->token, key, map->key_size);
+		b->started = true;
+		b->slow = true;
+
+		if (bpf_map_lookup_elem(map->fd.fd, key, val))
+			continue;
+
+		if (delete)
+			bpf_map_delete_elem(map->fd.fd, key);
+
+		key += map->key_size;
+		val += b->val_size;
+		b->count++;
+	}
+
+	return b->count;
+}
+
+static int
+uc_bpf_batch_next(struct uc_bpf_map *map, struct uc_bpf_batch *b, bool delete)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	void *in = b->started ? b->token : NULL;
+	unsigned int op = delete ? UC_BPF_BATCH_LOOKUP_DELETE : UC_BPF_BATCH_LOOKUP;
+	__u32 count;
+	int ret;
+
+	b->count = 0;
+	if (b->done)
+		return 0;
+
+	if (b->slow || (map->no_batch & op))
+		return uc_bpf_batch_next_slow(map, b, delete);
+
+retry:
+	count = b->size;
+	if (delete)
+		ret = bpf_map_lookup_and_delete_batch(map->fd.fd, in, b->token,
+						      b->keys, b->vals, &count, &opts);
+	else
+		ret = bpf_map_lookup_batch(map->fd.fd, in, b->token,
+					   b->keys, b->vals, &count, &opts);
+	ret = ret ? errno : 0;
+
+	/* a hash bucket holds more entries than fit into the buffer */
+	if (ret == ENOSPC && !count) {
+		__u32 size = uc_bpf_batch_clamp(map, b, (size_t)b->size * 2);
+
+		if (size <= b->size)
+			err_return_int(ENOSPC, NULL);
+
+		b->size = size;
+		b->keys = xrealloc(b->keys, (size_t)b->size * map->key_size);
+		b->vals = xrealloc(b->vals, (size_t)b->size * b->val_size);
+		goto retry;
+	}
+
+	if (ret && ret != ENOENT) {
+		if (!b->started && uc_bpf_batch_unsupported(ret)) {
+			map->no_batch |= op;
+			return uc_bpf_batch_next_slow(map, b, delete);
+		}
+
+		err_return_int(ret, NULL);
+	}
+
+	b->started = true;
+	b->done = ret == ENOENT;
+	b->count = count;
+
+	return count;
+}
+
+static void
+uc_bpf_batch_add_entries(uc_vm_t *vm, struct uc_bpf_map *map,
+			 struct uc_bpf_batch *b, uc_value_t *list)
+{
+	const char *key = b->keys, *val = b->vals;
+	__u32 i;
+
+	for (i = 0; i < b->count; i++) {
+		uc_value_t *entry = ucv_array_new_length(vm, 2);
+
+		ucv_array_push(entry, uc_bpf_map_unpack(vm, map, true, key, map->key_size));
+		ucv_array_push(entry, uc_bpf_map_unpack(vm, map, false, val, b->val_size));
+		ucv_array_push(list, entry);
+
+		key += map->key_size;
+		val += b->val_size;
+	}
 }
 
 static uc_value_t *
@@ -456,6 +1152,20 @@ uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 	if (!map)
 		err_return(EINVAL, NULL);
 
+	if (!ucv_is_callable(filter)) {
+		struct uc_bpf_batch b;
+		int ret;
+
+		uc_bpf_batch_init(map, &b, 0);
+		while ((ret = uc_bpf_batch_next(map, &b, true)) > 0);
+		uc_bpf_batch_free(&b);
+
+		if (ret < 0)
+			return NULL;
+
+		return TRUE;
+	}
+
 	key = alloca(map->key_size);
 	next = alloca(map->key_size);
 	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
@@ -469,7 +1179,7 @@ uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 			uc_value_t *rv;
 
 			uc_value_push(ucv_get(filter));
-			uc_value_push(ucv_string_new_length((const char *)key, map->key_size));
+			uc_value_push(uc_bpf_map_unpack(vm, map, true, key, map->key_size));
 			if (uc_call(1) != EXCEPTION_NONE)
 				break;
 
@@ -564,7 +1274,7 @@ uc_bpf_map_foreach(uc_vm_t *vm, size_t nargs)
 		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
 
 		uc_value_push(ucv_get(func));
-		uc_value_push(ucv_string_new_length((const char *)key, map->key_size));
+		uc_value_push(uc_bpf_map_unpack(vm, map, true, key, map->key_size));
 
 		if (uc_call(1) != EXCEPTION_NONE)
 			break;
@@ -583,19 +1293,782 @@ uc_bpf_map_foreach(uc_vm_t *vm, size_t nargs)
 }
 
 static uc_value_t *
-uc_bpf_obj_pin(uc_vm_t *vm, size_t nargs, const char *type)
+uc_bpf_map_dump(uc_vm_t *vm, size_t nargs)
 {
-	struct uc_bpf_fd *f = uc_fn_thisval(type);
-	uc_value_t *path = uc_fn_arg(0);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_delete = uc_fn_arg(0);
+	bool delete = ucv_is_truish(a_delete);
+	struct uc_bpf_batch b;
+	uc_value_t *rv;
+	int ret;
 
-	if (ucv_type(path) != UC_STRING)
+	if (!map)
 		err_return(EINVAL, NULL);
 
-	if (bpf_obj_pin(f->fd, ucv_string_get(path)))
-		err_return(errno, NULL);
-
-	return TRUE;
-}
+	uc_bpf_batch_init(map, &b, 0);
+	rv = ucv_array_new(vm);
+	while ((ret = uc_bpf_batch_next(map, &b, delete)) > 0)
+		uc_bpf_batch_add_entries(vm, map, &b, rv);
+	uc_bpf_batch_free(&b);
+
+	if (ret < 0) {
+		ucv_put(rv);
+		return NULL;
+	}
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_get_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_count = uc_fn_arg(0);
+	uc_value_t *a_cursor = uc_fn_arg(1);
+	struct uc_bpf_batch b;
+	uc_value_t *rv, *list;
+	int64_t count = 0;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (a_count) {
+		if (ucv_type(a_count) != UC_INTEGER)
+			err_return(EINVAL, "count");
+
+		count = ucv_int64_get(a_count);
+		if (count <= 0 || count > UINT32_MAX / 2)
+			err_return(EINVAL, "count");
+	}
+
+	uc_bpf_batch_init(map, &b, count);
+	if (a_cursor) {
+		const uint8_t *cursor = (const uint8_t *)ucv_string_get(a_cursor);
+
+		if (!cursor || ucv_string_length(a_cursor) != b.token_size + 1 ||
+		    cursor[0] > UC_BPF_CURSOR_KEY) {
+			uc_bpf_batch_free(&b);
+			err_return(EINVAL, "invalid cursor");
+		}
+
+		memcpy(b.token, cursor + 1, b.token_size);
+		b.slow = cursor[0] == UC_BPF_CURSOR_KEY;
+		b.started = true;
+	}
+
+	if (uc_bpf_batch_next(map, &b, false) < 0) {
+		uc_bpf_batch_free(&b);
+		return NULL;
+	}
+
+	list = ucv_array_new_length(vm, b.count);
+	uc_bpf_batch_add_entries(vm, map, &b, list);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "entries", list);
+	if (!b.done) {
+		char *cursor = xalloc(b.token_size + 1);
+
+		cursor[0] = b.slow ? UC_BPF_CURSOR_KEY : UC_BPF_CURSOR_BATCH;
+		memcpy(cursor + 1, b.token, b.token_size);
+		ucv_object_add(rv, "cursor", ucv_string_new_length(cursor, b.token_size + 1));
+		free(cursor);
+	}
+	uc_bpf_batch_free(&b);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_set_batch(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_entries = uc_fn_arg(0);
+	uc_value_t *a_flags = uc_fn_arg(1);
+	uint8_t *keys = NULL, *vals = NULL;
+	unsigned int val_size;
+	__u32 count, i;
+	int ret = 0;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (ucv_type(a_entries) != UC_ARRAY)
+		err_return(EINVAL, "entries");
+
+	if (!a_flags)
+		opts.elem_flags = BPF_ANY;
+	else if (ucv_type(a_flags) != UC_INTEGER)
+		err_return(EINVAL, "flags");
+	else
+		opts.elem_flags = ucv_int64_get(a_flags);
+
+	count = ucv_array_length(a_entries);
+	if (!count)
+		return ucv_int64_new(0);
+
+	val_size = uc_bpf_map_batch_val_size(map);
+	keys = xalloc((size_t)count * map->key_size);
+	vals = xalloc((size_t)count * val_size);
+	for (i = 0; i < count; i++) {
+		uc_value_t *entry = ucv_array_get(a_entries, i);
+
+		if (ucv_type(entry) != UC_ARRAY || ucv_array_length(entry) != 2) {
+			set_error(EINVAL, "entry %u", i);
+			goto error;
+		}
+
+		if (uc_bpf_map_pack(map, true, ucv_array_get(entry, 0),
+				    keys + i * map->key_size, map->key_size) ||
+		    uc_bpf_map_pack(map, false, ucv_array_get(entry, 1),
+				    vals + i * val_size, val_size))
+			goto error;
+	}
+
+	if (!(map->no_batch & UC_BPF_BATCH_UPDATE)) {
+		ret = bpf_map_update_batch(map->fd.fd, keys, vals, &count, &opts);
+		ret = ret ? errno : 0;
+		if (uc_bpf_batch_unsupported(ret))
+			map->no_batch |= UC_BPF_BATCH_UPDATE;
+	}
+
+	if (map->no_batch & UC_BPF_BATCH_UPDATE) {
+		for (count = 0, ret = 0; count < i; count++) {
+			if (bpf_map_update_elem(map->fd.fd, keys + count * map->key_size,
+						vals + count * val_size,
+						opts.elem_flags)) {
+				ret = errno;
+				break;
+			}
+		}
+	}
+
+	if (ret) {
+		set_error(ret, "%u of %u entries updated", count, i);
+		goto error;
+	}
+
+	free(keys);
+	free(vals);
+
+	return ucv_int64_new(count);
+
+error:
+	free(keys);
+	free(vals);
+	return NULL;
+}
+
+static uc_value_t *
+uc_bpf_map_delete_batch(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	__u32 len, count, i, done = 0, deleted = 0;
+	uint8_t *keys;
+	int ret;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (ucv_type(a_keys) != UC_ARRAY)
+		err_return(EINVAL, "keys");
+
+	len = ucv_array_length(a_keys);
+	keys = xalloc((size_t)len * map->key_size + 1);
+	for (i = 0; i < len; i++) {
+		if (uc_bpf_map_pack(map, true, ucv_array_get(a_keys, i),
+				    keys + i * map->key_size, map->key_size)) {
+			free(keys);
+			return NULL;
+		}
+	}
+
+	/* the kernel stops at the first key that does not exist, skip it and
+	 * carry on with the rest */
+	while (done < len && !(map->no_batch & UC_BPF_BATCH_DELETE)) {
+		count = len - done;
+		ret = bpf_map_delete_batch(map->fd.fd, keys + done * map->key_size,
+					   &count, &opts);
+		ret = ret ? errno : 0;
+		if (uc_bpf_batch_unsupported(ret)) {
+			map->no_batch |= UC_BPF_BATCH_DELETE;
+			break;
+		}
+
+		done += count;
+		deleted += count;
+		if (!ret)
+			break;
+
+		if (ret != ENOENT) {
+			free(keys);
+			err_return(ret, NULL);
+		}
+
+		done++;
+	}
+
+	for (; done < len; done++)
+		if (!bpf_map_delete_elem(map->fd.fd, keys + done * map->key_size))
+			deleted++;
+
+	free(keys);
+
+	return ucv_int64_new(deleted);
+}
+
+static void
+uc_bpf_ringbuf_invoke(struct uc_bpf_ringbuf *rb, uc_value_t *data, int cpu)
+{
+	uc_vm_t *vm = rb->vm;
+
+	rb->records++;
+	uc_vm_stack_push(vm, ucv_get(ucv_array_get(registry, rb->registry_index)));
+	uc_vm_stack_push(vm, data);
+	if (cpu >= 0)
+		uc_vm_stack_push(vm, ucv_int64_new(cpu));
+
+	if (uc_vm_call(vm, false, cpu >= 0 ? 2 : 1) == EXCEPTION_NONE) {
+		ucv_put(uc_vm_stack_pop(vm));
+		return;
+	}
+
+	rb->error = true;
+	uloop_end();
+}
+
+static int
+uc_bpf_ringbuf_sample_cb(void *ctx, void *data, size_t size)
+{
+	struct uc_bpf_ringbuf *rb = ctx;
+
+	if (rb->error)
+		return -1;
+
+	uc_bpf_ringbuf_invoke(rb, ucv_string_new_length(data, size), -1);
+
+	return rb->error ? -1 : 0;
+}
+
+static void
+uc_bpf_perfbuf_sample_cb(void *ctx, int cpu, void *data, __u32 size)
+{
+	struct uc_bpf_ringbuf *rb = ctx;
+
+	if (rb->error)
+		return;
+
+	uc_bpf_ringbuf_invoke(rb, ucv_string_new_length(data, size), cpu);
+}
+
+static void
+uc_bpf_perfbuf_lost_cb(void *ctx, int cpu, __u64 cnt)
+{
+	struct uc_bpf_ringbuf *rb = ctx;
+
+	rb->lost += cnt;
+}
+
+static void
+uc_bpf_ringbuf_close(struct uc_bpf_ringbuf *rb)
+{
+	if (rb->fd.registered)
+		uloop_fd_delete(&rb->fd);
+
+	if (rb->registry_index) {
+		ucv_array_set(registry, rb->registry_index, NULL);
+		rb->registry_index = 0;
+	}
+
+	/* closed from within a callback, the buffer is released once
+	 * uc_bpf_ringbuf_consume() returns */
+	if (rb->consuming) {
+		rb->error = true;
+		return;
+	}
+
+	ring_buffer__free(rb->rb);
+	rb->rb = NULL;
+	perf_buffer__free(rb->pb);
+	rb->pb = NULL;
+}
+
+/* drains all records that are ready, stops early if a callback throws */
+static int
+uc_bpf_ringbuf_consume(struct uc_bpf_ringbuf *rb)
+{
+	uint64_t records = rb->records;
+	int ret;
+
+	rb->error = false;
+	rb->consuming = true;
+	if (rb->rb)
+		ret = ring_buffer__consume(rb->rb);
+	else
+		ret = perf_buffer__consume(rb->pb);
+	rb->consuming = false;
+
+	if (ret >= 0 || rb->error)
+		ret = rb->records - records;
+
+	if (!rb->registry_index)
+		uc_bpf_ringbuf_close(rb);
+
+	if (rb->free_pending)
+		free(rb);
+
+	return ret;
+}
+
+static void
+uc_bpf_ringbuf_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct uc_bpf_ringbuf *rb = container_of(fd, struct uc_bpf_ringbuf, fd);
+
+	rb->wakeups++;
+	uc_bpf_ringbuf_consume(rb);
+}
+
+static size_t
+uc_bpf_registry_add(uc_value_t *val)
+{
+	size_t i, len = ucv_array_length(registry);
+
+	/* slot 0 holds the debug handler */
+	for (i = 1; i < len; i++)
+		if (!ucv_array_get(registry, i))
+			break;
+
+	ucv_array_set(registry, i, ucv_get(val));
+
+	return i;
+}
+
+static uc_value_t *
+uc_bpf_map_ringbuf_open(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *cb = uc_fn_arg(0);
+	uc_value_t *a_pages = uc_fn_arg(1);
+	size_t pages = PERF_BUFFER_PAGES;
+	struct uc_bpf_ringbuf *rb;
+
+	if (!map || !ucv_is_callable(cb))
+		err_return(EINVAL, NULL);
+
+	if (a_pages) {
+		if (ucv_type(a_pages) != UC_INTEGER || ucv_int64_get(a_pages) <= 0)
+			err_return(EINVAL, "pages");
+
+		pages = ucv_int64_get(a_pages);
+	}
+
+	rb = xalloc(sizeof(*rb));
+	rb->vm = vm;
+	rb->fd.cb = uc_bpf_ringbuf_fd_cb;
+
+	switch (map->type) {
+	case BPF_MAP_TYPE_RINGBUF:
+		rb->rb = ring_buffer__new(map->fd.fd, uc_bpf_ringbuf_sample_cb, rb, NULL);
+		if (!rb->rb)
+			goto error;
+
+		rb->fd.fd = ring_buffer__epoll_fd(rb->rb);
+		break;
+	case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
+		rb->pb = perf_buffer__new(map->fd.fd, pages, uc_bpf_perfbuf_sample_cb,
+					  uc_bpf_perfbuf_lost_cb, rb, NULL);
+		if (!rb->pb)
+			goto error;
+
+		rb->fd.fd = perf_buffer__epoll_fd(rb->pb);
+		break;
+	default:
+		free(rb);
+		err_return(EINVAL, "map type");
+	}
+
+	if (uloop_fd_add(&rb->fd, ULOOP_READ))
+		goto error;
+
+	rb->registry_index = uc_bpf_registry_add(cb);
+
+	return uc_resource_new(ringbuf_type, rb);
+
+error:
+	set_error(errno, NULL);
+	uc_bpf_ringbuf_close(rb);
+	free(rb);
+	return NULL;
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_consume_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *rb = uc_fn_thisval("bpf.ringbuf");
+	int ret;
+
+	if (!rb || !rb->registry_index)
+		err_return(EINVAL, NULL);
+
+	if (rb->consuming)
+		err_return(EBUSY, NULL);
+
+	ret = uc_bpf_ringbuf_consume(rb);
+	if (ret < 0)
+		err_return(-ret, NULL);
+
+	return ucv_int64_new(ret);
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_stats(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *rb = uc_fn_thisval("bpf.ringbuf");
+	uc_value_t *rv;
+
+	if (!rb)
+		err_return(EINVAL, NULL);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "records", ucv_uint64_new(rb->records));
+	/* ring buffer records that did not fit fail to be reserved in the
+	 * producer, only the perf buffer reports its losses to the consumer */
+	if (rb->pb)
+		ucv_object_add(rv, "lost", ucv_uint64_new(rb->lost));
+	ucv_object_add(rv, "wakeups", ucv_uint64_new(rb->wakeups));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_fileno(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *rb = uc_fn_thisval("bpf.ringbuf");
+
+	if (!rb || !rb->registry_index)
+		err_return(EINVAL, NULL);
+
+	return ucv_int64_new(rb->fd.fd);
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_close_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *rb = uc_fn_thisval("bpf.ringbuf");
+
+	if (!rb)
+		err_return(EINVAL, NULL);
+
+	uc_bpf_ringbuf_close(rb);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_map_percpu_sum(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_key = uc_fn_arg(0);
+	uc_value_t *a_offset = uc_fn_arg(1);
+	uc_value_t *a_size = uc_fn_arg(2);
+	unsigned int stride, offset = 0, size = 8;
+	uint64_t sum = 0;
+	uint8_t *val;
+	int i, ncpus;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	ncpus = libbpf_num_possible_cpus();
+	if (ncpus <= 0)
+		err_return(-ncpus, "possible cpus");
+
+	if (!uc_bpf_map_is_percpu(map))
+		err_return(EINVAL, "not a per-cpu map");
+
+	if (a_offset) {
+		if (ucv_type(a_offset) != UC_INTEGER)
+			err_return(EINVAL, "offset");
+		offset = ucv_int64_get(a_offset);
+	}
+
+	if (a_size) {
+		if (ucv_type(a_size) != UC_INTEGER)
+			err_return(EINVAL, "size");
+		size = ucv_int64_get(a_size);
+	}
+
+	if ((size != 4 && size != 8) || offset % size ||
+	    offset > map->val_size || map->val_size - offset < size)
+		err_return(EINVAL, "offset/size");
+
+	if (uc_bpf_map_pack(map, true, a_key, map->key_buf, map->key_size))
+		return NULL;
+
+	stride = (map->val_size + 7) & ~7;
+	val = xalloc(stride * ncpus);
+	if (bpf_map_lookup_elem(map->fd.fd, map->key_buf, val)) {
+		free(val);
+		return NULL;
+	}
+
+	for (i = 0; i < ncpus; i++) {
+		if (size == 4)
+			sum += *(uint32_t *)(val + i * stride + offset);
+		else
+			sum += *(uint64_t *)(val + i * stride + offset);
+	}
+	free(val);
+
+	return ucv_uint64_new(sum);
+}
+
+static uc_value_t *
+uc_bpf_map_mmap(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	struct uc_bpf_map_mmap *mm;
+	long page_size = sysconf(_SC_PAGESIZE);
+	bool writable = true;
+	size_t size;
+	void *data;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (map->type != BPF_MAP_TYPE_ARRAY || !(map->map_flags & BPF_F_MMAPABLE))
+		err_return(EINVAL, "not a mmapable array map");
+
+	size = (size_t)((map->val_size + 7) & ~7) * map->max_entries;
+	size = (size + page_size - 1) & ~(page_size - 1);
+
+	/* frozen maps and maps read-only to user space can only be mapped
+	 * read-only */
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd.fd, 0);
+	if (data == MAP_FAILED && (errno == EPERM || errno == EACCES)) {
+		data = mmap(NULL, size, PROT_READ, MAP_SHARED, map->fd.fd, 0);
+		writable = false;
+	}
+	if (data == MAP_FAILED)
+		err_return(errno, NULL);
+
+	mm = xalloc(sizeof(*mm));
+	mm->data = data;
+	mm->size = size;
+	mm->stride = (map->val_size + 7) & ~7;
+	mm->val_size = map->val_size;
+	mm->max_entries = map->max_entries;
+	mm->writable = writable;
+
+	return uc_resource_new(map_mmap_type, mm);
+}
+
+/* index may be NULL when only the offset is to be validated */
+static void *
+uc_bpf_mmap_ptr(struct uc_bpf_map_mmap *mm, uc_value_t *index,
+		uc_value_t *offset, unsigned int size)
+{
+	uint64_t idx = 0, ofs = 0;
+
+	if (!mm || !mm->data)
+		err_return(EINVAL, NULL);
+
+	if (index) {
+		if (ucv_type(index) != UC_INTEGER)
+			err_return(EINVAL, "index");
+
+		idx = ucv_int64_get(index);
+		if (idx >= mm->max_entries)
+			err_return(ERANGE, "index");
+	}
+
+	if (offset) {
+		if (ucv_type(offset) != UC_INTEGER)
+			err_return(EINVAL, "offset");
+		ofs = ucv_int64_get(offset);
+	}
+
+	if (ofs % size || ofs > mm->val_size || mm->val_size - ofs < size)
+		err_return(EINVAL, "offset");
+
+	return (uint8_t *)mm->data + idx * mm->stride + ofs;
+}
+
+static uc_value_t *
+uc_bpf_mmap_get_int(uc_vm_t *vm, size_t nargs, unsigned int size)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+	uc_value_t *index = uc_fn_arg(0);
+	void *ptr;
+
+	if (!index)
+		err_return(EINVAL, "index");
+
+	ptr = uc_bpf_mmap_ptr(mm, index, uc_fn_arg(1), size);
+	if (!ptr)
+		return NULL;
+
+	if (size == 4)
+		return ucv_uint64_new(*(volatile uint32_t *)ptr);
+
+	return ucv_uint64_new(*(volatile uint64_t *)ptr);
+}
+
+static uc_value_t *
+uc_bpf_mmap_set_int(uc_vm_t *vm, size_t nargs, unsigned int size)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+	uc_value_t *index = uc_fn_arg(0);
+	uc_value_t *val = uc_fn_arg(1);
+	void *ptr;
+
+	if (!index || ucv_type(val) != UC_INTEGER)
+		err_return(EINVAL, NULL);
+
+	if (mm && !mm->writable)
+		err_return(EPERM, "map is mapped read-only");
+
+	ptr = uc_bpf_mmap_ptr(mm, index, uc_fn_arg(2), size);
+	if (!ptr)
+		return NULL;
+
+	if (size == 4)
+		*(volatile uint32_t *)ptr = ucv_uint64_get(val);
+	else
+		*(volatile uint64_t *)ptr = ucv_uint64_get(val);
+
+	return TRUE;
+}
+
+/* reads one field of every element in a single call */
+static uc_value_t *
+uc_bpf_mmap_list_int(uc_vm_t *vm, size_t nargs, unsigned int size)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+	uc_value_t *a_offset = uc_fn_arg(0);
+	uint8_t *ptr;
+	uc_value_t *rv;
+	unsigned int i;
+
+	ptr = uc_bpf_mmap_ptr(mm, NULL, a_offset, size);
+	if (!ptr)
+		return NULL;
+
+	rv = ucv_array_new_length(vm, mm->max_entries);
+	for (i = 0; i < mm->max_entries; i++, ptr += mm->stride) {
+		if (size == 4)
+			ucv_array_push(rv, ucv_uint64_new(*(volatile uint32_t *)ptr));
+		else
+			ucv_array_push(rv, ucv_uint64_new(*(volatile uint64_t *)ptr));
+	}
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_mmap_u32(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_get_int(vm, nargs, 4);
+}
+
+static uc_value_t *
+uc_bpf_mmap_u64(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_get_int(vm, nargs, 8);
+}
+
+static uc_value_t *
+uc_bpf_mmap_set_u32(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_set_int(vm, nargs, 4);
+}
+
+static uc_value_t *
+uc_bpf_mmap_set_u64(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_set_int(vm, nargs, 8);
+}
+
+static uc_value_t *
+uc_bpf_mmap_list_u32(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_list_int(vm, nargs, 4);
+}
+
+static uc_value_t *
+uc_bpf_mmap_list_u64(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_mmap_list_int(vm, nargs, 8);
+}
+
+static uc_value_t *
+uc_bpf_mmap_get(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+	uc_value_t *index = uc_fn_arg(0);
+	void *ptr;
+
+	if (!index)
+		err_return(EINVAL, "index");
+
+	ptr = uc_bpf_mmap_ptr(mm, index, NULL, 1);
+	if (!ptr)
+		return NULL;
+
+	return ucv_string_new_length(ptr, mm->val_size);
+}
+
+static uc_value_t *
+uc_bpf_mmap_length(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+
+	if (!mm || !mm->data)
+		err_return(EINVAL, NULL);
+
+	return ucv_int64_new(mm->max_entries);
+}
+
+static void uc_bpf_mmap_free(void *ptr)
+{
+	struct uc_bpf_map_mmap *mm = ptr;
+
+	if (mm->data)
+		munmap(mm->data, mm->size);
+	mm->data = NULL;
+}
+
+static uc_value_t *
+uc_bpf_mmap_close(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *mm = uc_fn_thisval("bpf.map_mmap");
+
+	if (!mm)
+		err_return(EINVAL, NULL);
+
+	uc_bpf_mmap_free(mm);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_obj_pin(uc_vm_t *vm, size_t nargs, const char *type)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval(type);
+	uc_value_t *path = uc_fn_arg(0);
+
+	if (ucv_type(path) != UC_STRING)
+		err_return(EINVAL, NULL);
+
+	if (bpf_obj_pin(f->fd, ucv_string_get(path)))
+		err_return(errno, NULL);
+
+	return TRUE;
+}
 
 static uc_value_t *
 uc_bpf_program_pin(uc_vm_t *vm, size_t nargs)
@@ -609,45 +2082,61 @@ uc_bpf_map_pin(uc_vm_t *vm, size_t nargs)
 	return uc_bpf_obj_pin(vm, nargs, "bpf.map");
 }
 
-static uc_value_t *
-uc_bpf_set_tc_hook(uc_value_t *ifname, uc_value_t *type, uc_value_t *prio,
-		   int fd)
+static int
+uc_bpf_tc_hook_parse(uc_value_t *ifname, uc_value_t *type, uc_value_t *prio,
+		     struct bpf_tc_hook *hook, struct bpf_tc_opts *opts)
 {
-	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook);
-	DECLARE_LIBBPF_OPTS(bpf_tc_opts, attach_tc,
-			    .handle = 1);
 	const char *type_str;
 	uint64_t prio_val;
 
 	if (ucv_type(ifname) != UC_STRING || ucv_type(type) != UC_STRING ||
 	    ucv_type(prio) != UC_INTEGER)
-		err_return(EINVAL, NULL);
+		err_return_int(EINVAL, NULL);
 
 	prio_val = ucv_int64_get(prio);
 	if (prio_val > 0xffff)
-		err_return(EINVAL, NULL);
+		err_return_int(EINVAL, NULL);
 
 	type_str = ucv_string_get(type);
 	if (!strcmp(type_str, "ingress"))
-		hook.attach_point = BPF_TC_INGRESS;
+		hook->attach_point = BPF_TC_INGRESS;
 	else if (!strcmp(type_str, "egress"))
-		hook.attach_point = BPF_TC_EGRESS;
+		hook->attach_point = BPF_TC_EGRESS;
 	else
-		err_return(EINVAL, NULL);
+		err_return_int(EINVAL, NULL);
+
+	hook->ifindex = if_nametoindex(ucv_string_get(ifname));
+	opts->priority = prio_val;
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_set_tc_hook(uc_value_t *ifname, uc_value_t *type, uc_value_t *prio,
+		   int fd)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, attach_tc,
+			    .handle = 1);
+
+	if (uc_bpf_tc_hook_parse(ifname, type, prio, &hook, &attach_tc))
+		return NULL;
 
-	hook.ifindex = if_nametoindex(ucv_string_get(ifname));
 	if (!hook.ifindex)
 		goto error;
 
 	bpf_tc_hook_create(&hook);
-	attach_tc.priority = prio_val;
-	if (bpf_tc_detach(&hook, &attach_tc) < 0 && fd < 0)
-		goto error;
+	if (fd < 0) {
+		if (bpf_tc_detach(&hook, &attach_tc) < 0)
+			goto error;
 
-	if (fd < 0)
 		goto out;
+	}
 
+	/* replace an existing filter in place, detaching it first would let
+	 * packets pass unfiltered in between */
 	attach_tc.prog_fd = fd;
+	attach_tc.flags = BPF_TC_F_REPLACE;
 	if (bpf_tc_attach(&hook, &attach_tc) < 0)
 		goto error;
 
@@ -684,6 +2173,288 @@ uc_bpf_tc_detach(uc_vm_t *vm, size_t nargs)
 	return uc_bpf_set_tc_hook(ifname, type, prio, -1);
 }
 
+static uc_value_t *
+uc_bpf_tc_query(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_tc_hook, hook);
+	DECLARE_LIBBPF_OPTS(bpf_tc_opts, opts,
+			    .handle = 1);
+
+	if (uc_bpf_tc_hook_parse(uc_fn_arg(0), uc_fn_arg(1), uc_fn_arg(2),
+				 &hook, &opts))
+		return NULL;
+
+	if (!hook.ifindex)
+		err_return(ENODEV, NULL);
+
+	if (bpf_tc_query(&hook, &opts) < 0)
+		return NULL;
+
+	return ucv_int64_new(opts.prog_id);
+}
+
+static int
+uc_bpf_ifindex(uc_value_t *ifname)
+{
+	int ifindex;
+
+	if (ucv_type(ifname) != UC_STRING)
+		err_return_int(EINVAL, "ifname");
+
+	ifindex = if_nametoindex(ucv_string_get(ifname));
+	if (!ifindex)
+		err_return_int(ENODEV, "%s", ucv_string_get(ifname));
+
+	return ifindex;
+}
+
+/* no mode lets the kernel pick native mode if the driver supports it */
+static int
+uc_bpf_xdp_flags(uc_value_t *mode, __u32 *flags)
+{
+	const char *str;
+
+	*flags = 0;
+	if (!mode)
+		return 0;
+
+	if (ucv_type(mode) != UC_STRING)
+		err_return_int(EINVAL, "mode");
+
+	str = ucv_string_get(mode);
+	if (!strcmp(str, "native") || !strcmp(str, "drv"))
+		*flags = XDP_FLAGS_DRV_MODE;
+	else if (!strcmp(str, "generic") || !strcmp(str, "skb"))
+		*flags = XDP_FLAGS_SKB_MODE;
+	else if (!strcmp(str, "offload") || !strcmp(str, "hw"))
+		*flags = XDP_FLAGS_HW_MODE;
+	else
+		err_return_int(EINVAL, "mode");
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_program_xdp_attach(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.program");
+	int ifindex;
+	__u32 flags;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	ifindex = uc_bpf_ifindex(uc_fn_arg(0));
+	if (ifindex < 0 || uc_bpf_xdp_flags(uc_fn_arg(1), &flags))
+		return NULL;
+
+	/* an attached program is replaced atomically */
+	if (bpf_xdp_attach(ifindex, f->fd, flags, NULL) < 0)
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_xdp_detach(uc_vm_t *vm, size_t nargs)
+{
+	int ifindex;
+	__u32 flags;
+
+	ifindex = uc_bpf_ifindex(uc_fn_arg(0));
+	if (ifindex < 0 || uc_bpf_xdp_flags(uc_fn_arg(1), &flags))
+		return NULL;
+
+	if (bpf_xdp_detach(ifindex, flags, NULL) < 0)
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_xdp_query(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_xdp_query_opts, opts);
+	static const char * const modes[] = {
+		[XDP_ATTACHED_NONE] = "none",
+		[XDP_ATTACHED_DRV] = "native",
+		[XDP_ATTACHED_SKB] = "generic",
+		[XDP_ATTACHED_HW] = "offload",
+		[XDP_ATTACHED_MULTI] = "multi",
+	};
+	uc_value_t *rv;
+	int ifindex;
+
+	ifindex = uc_bpf_ifindex(uc_fn_arg(0));
+	if (ifindex < 0)
+		return NULL;
+
+	if (bpf_xdp_query(ifindex, 0, &opts) < 0)
+		err_return(errno, NULL);
+
+	rv = ucv_object_new(vm);
+	if (opts.attach_mode < ARRAY_SIZE(modes) && modes[opts.attach_mode])
+		ucv_object_add(rv, "mode", ucv_string_new(modes[opts.attach_mode]));
+	ucv_object_add(rv, "prog_id", ucv_int64_new(opts.prog_id));
+	ucv_object_add(rv, "drv_prog_id", ucv_int64_new(opts.drv_prog_id));
+	ucv_object_add(rv, "skb_prog_id", ucv_int64_new(opts.skb_prog_id));
+	ucv_object_add(rv, "hw_prog_id", ucv_int64_new(opts.hw_prog_id));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_link_create(int fd)
+{
+	struct uc_bpf_fd *f;
+
+	f = xalloc(sizeof(*f));
+	f->fd = fd;
+	f->close = true;
+
+	return uc_resource_new(link_type, f);
+}
+
+/* The link is owned by the returned resource: the program stays attached
+ * until the link is detached, or closed without having been pinned. */
+static uc_value_t *
+uc_bpf_program_xdp_link(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_link_create_opts, opts);
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.program");
+	int ifindex, fd;
+	__u32 flags;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	ifindex = uc_bpf_ifindex(uc_fn_arg(0));
+	if (ifindex < 0 || uc_bpf_xdp_flags(uc_fn_arg(1), &flags))
+		return NULL;
+
+	opts.flags = flags;
+	fd = bpf_link_create(f->fd, ifindex, BPF_XDP, &opts);
+	if (fd < 0)
+		err_return(errno, NULL);
+
+	return uc_bpf_link_create(fd);
+}
+
+static uc_value_t *
+uc_bpf_program_info(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.program");
+	struct bpf_prog_info info = {};
+	__u32 len = sizeof(info);
+	uc_value_t *rv;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	if (bpf_obj_get_info_by_fd(f->fd, &info, &len))
+		err_return(errno, NULL);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "id", ucv_int64_new(info.id));
+	ucv_object_add(rv, "type", ucv_int64_new(info.type));
+	ucv_object_add(rv, "name", ucv_string_new(info.name));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_open_link(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *path = uc_fn_arg(0);
+	int fd;
+
+	if (ucv_type(path) != UC_STRING)
+		err_return(EINVAL, "link path");
+
+	fd = bpf_obj_get(ucv_string_get(path));
+	if (fd < 0)
+		err_return(errno, NULL);
+
+	return uc_bpf_link_create(fd);
+}
+
+/* swaps the program of a link atomically, optionally only if the
+ * currently attached one is old_program */
+static uc_value_t *
+uc_bpf_link_update(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_link_update_opts, opts);
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.link");
+	uc_value_t *a_prog = uc_fn_arg(0);
+	uc_value_t *a_old = uc_fn_arg(1);
+	void **prog, **old = NULL;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	prog = ucv_resource_dataptr(a_prog, "bpf.program");
+	if (!prog || !*prog)
+		err_return(EINVAL, "program");
+
+	if (a_old) {
+		old = ucv_resource_dataptr(a_old, "bpf.program");
+		if (!old || !*old)
+			err_return(EINVAL, "old program");
+
+		opts.flags = BPF_F_REPLACE;
+		opts.old_prog_fd = ((struct uc_bpf_fd *)*old)->fd;
+	}
+
+	if (bpf_link_update(f->fd, ((struct uc_bpf_fd *)*prog)->fd, &opts))
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_link_detach(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.link");
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	if (bpf_link_detach(f->fd))
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_link_info(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.link");
+	struct bpf_link_info info = {};
+	__u32 len = sizeof(info);
+	uc_value_t *rv;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	if (bpf_obj_get_info_by_fd(f->fd, &info, &len))
+		err_return(errno, NULL);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "id", ucv_int64_new(info.id));
+	ucv_object_add(rv, "prog_id", ucv_int64_new(info.prog_id));
+	ucv_object_add(rv, "type", ucv_int64_new(info.type));
+	if (info.type == BPF_LINK_TYPE_XDP)
+		ucv_object_add(rv, "ifindex", ucv_int64_new(info.xdp.ifindex));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_link_pin(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_obj_pin(vm, nargs, "bpf.link");
+}
+
 static int
 uc_bpf_debug_print(enum libbpf_print_level level, const char *format,
 		   va_list args)
@@ -740,6 +2511,7 @@ register_constants(uc_vm_t *vm, uc_value_t *scope)
 #define ADD_CONST(x) ucv_object_add(scope, #x, ucv_int64_new(x))
 	ADD_CONST(BPF_PROG_TYPE_SCHED_CLS);
 	ADD_CONST(BPF_PROG_TYPE_SCHED_ACT);
+	ADD_CONST(BPF_PROG_TYPE_XDP);
 
 	ADD_CONST(BPF_ANY);
 	ADD_CONST(BPF_NOEXIST);
@@ -769,8 +2541,29 @@ static const uc_function_list_t map_fns[] = {
 	{ "delete_all",			uc_bpf_map_delete_all },
 	{ "foreach",			uc_bpf_map_foreach },
 	{ "iterator",			uc_bpf_map_iterator },
+	{ "dump",			uc_bpf_map_dump },
+	{ "get_batch",			uc_bpf_map_get_batch },
+	{ "set_batch",			uc_bpf_map_set_batch },
+	{ "delete_batch",		uc_bpf_map_delete_batch },
+	{ "ringbuf_open",		uc_bpf_map_ringbuf_open },
+	{ "percpu_sum",			uc_bpf_map_percpu_sum },
+	{ "mmap",			uc_bpf_map_mmap },
+	{ "set_codec",			uc_bpf_map_set_codec },
 };
 
+static void uc_bpf_map_free(void *ptr)
+{
+	struct uc_bpf_map *map = ptr;
+
+	ucv_put(map->key_codec_res);
+	ucv_put(map->val_codec_res);
+	free(map->key_buf);
+	free(map->val_buf);
+	if (map->fd.close)
+		close(map->fd.fd);
+	free(map);
+}
+
 static void uc_bpf_fd_free(void *ptr)
 {
 	struct uc_bpf_fd *f = ptr;
@@ -780,6 +2573,58 @@ static void uc_bpf_fd_free(void *ptr)
 	free(f);
 }
 
+static void uc_bpf_ringbuf_free(void *ptr)
+{
+	struct uc_bpf_ringbuf *rb = ptr;
+
+	uc_bpf_ringbuf_close(rb);
+	if (rb->consuming)
+		rb->free_pending = true;
+	else
+		free(rb);
+}
+
+static const uc_function_list_t ringbuf_fns[] = {
+	{ "consume",			uc_bpf_ringbuf_consume_fn },
+	{ "stats",			uc_bpf_ringbuf_stats },
+	{ "fileno",			uc_bpf_ringbuf_fileno },
+	{ "close",			uc_bpf_ringbuf_close_fn },
+};
+
+static void uc_bpf_map_mmap_free(void *ptr)
+{
+	uc_bpf_mmap_free(ptr);
+	free(ptr);
+}
+
+static const uc_function_list_t map_mmap_fns[] = {
+	{ "u32",			uc_bpf_mmap_u32 },
+	{ "u64",			uc_bpf_mmap_u64 },
+	{ "set_u32",			uc_bpf_mmap_set_u32 },
+	{ "set_u64",			uc_bpf_mmap_set_u64 },
+	{ "list_u32",			uc_bpf_mmap_list_u32 },
+	{ "list_u64",			uc_bpf_mmap_list_u64 },
+	{ "get",			uc_bpf_mmap_get },
+	{ "length",			uc_bpf_mmap_length },
+	{ "close",			uc_bpf_mmap_close },
+};
+
+static void uc_bpf_codec_free(void *ptr)
+{
+	struct uc_bpf_codec *codec = ptr;
+	unsigned int i;
+
+	for (i = 0; i < codec->n_fields; i++)
+		free(codec->fields[i].name);
+	free(codec);
+}
+
+static const uc_function_list_t codec_fns[] = {
+	{ "pack",			uc_bpf_codec_pack_fn },
+	{ "unpack",			uc_bpf_codec_unpack_fn },
+	{ "size",			uc_bpf_codec_size },
+};
+
 static const uc_function_list_t map_iter_fns[] = {
 	{ "next",			uc_bpf_map_iter_next },
 	{ "next_int",			uc_bpf_map_iter_next_int },
@@ -788,6 +2633,16 @@ static const uc_function_list_t map_iter_fns[] = {
 static const uc_function_list_t prog_fns[] = {
 	{ "pin",			uc_bpf_program_pin },
 	{ "tc_attach",			uc_bpf_program_tc_attach },
+	{ "xdp_attach",			uc_bpf_program_xdp_attach },
+	{ "xdp_link",			uc_bpf_program_xdp_link },
+	{ "info",			uc_bpf_program_info },
+};
+
+static const uc_function_list_t link_fns[] = {
+	{ "pin",			uc_bpf_link_pin },
+	{ "update",			uc_bpf_link_update },
+	{ "detach",			uc_bpf_link_detach },
+	{ "info",			uc_bpf_link_info },
 };
 
 static const uc_function_list_t global_fns[] = {
@@ -796,7 +2651,12 @@ static const uc_function_list_t global_fns[] = {
 	{ "open_module",		uc_bpf_open_module },
 	{ "open_map",			uc_bpf_open_map },
 	{ "open_program",		uc_bpf_open_program },
+	{ "codec",			uc_bpf_codec_new },
+	{ "open_link",			uc_bpf_open_link },
 	{ "tc_detach",			uc_bpf_tc_detach },
+	{ "tc_query",			uc_bpf_tc_query },
+	{ "xdp_detach",			uc_bpf_xdp_detach },
+	{ "xdp_query",			uc_bpf_xdp_query },
 };
 
 void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
@@ -808,7 +2668,11 @@ void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
 	uc_vm_registry_set(vm, "bpf.registry", registry);
 
 	module_type = uc_type_declare(vm, "bpf.module", module_fns, module_free);
-	map_type = uc_type_declare(vm, "bpf.map", map_fns, uc_bpf_fd_free);
+	map_type = uc_type_declare(vm, "bpf.map", map_fns, uc_bpf_map_free);
 	map_iter_type = uc_type_declare(vm, "bpf.map_iter", map_iter_fns, free);
 	program_type = uc_type_declare(vm, "bpf.program", prog_fns, uc_bpf_fd_free);
+	ringbuf_type = uc_type_declare(vm, "bpf.ringbuf", ringbuf_fns, uc_bpf_ringbuf_free);
+	map_mmap_type = uc_type_declare(vm, "bpf.map_mmap", map_mmap_fns, uc_bpf_map_mmap_free);
+	codec_type = uc_type_declare(vm, "bpf.codec", codec_fns, uc_bpf_codec_free);
+	link_type = uc_type_declare(vm, "bpf.link", link_fns, uc_bpf_fd_free);
 }
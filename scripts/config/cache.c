@@ -0,0 +1,864 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Cache of the parsed and finalized menu tree.
+ *
+ * The result of conf_parse() only depends on the Kconfig files that were
+ * sourced, on the environment variables and $(shell,...) commands that were
+ * expanded while reading them, and on the files each 'source' glob resolved
+ * to.  All of these are recorded while parsing and stored together with the
+ * symbols, properties, menus and expressions, so that the next invocation can
+ * verify its inputs and load the tree instead of parsing it again.
+ *
+ * The cache file is host local and uses native byte order.  Strings are
+ * stored NUL terminated and referenced in place from the loaded buffer.
+ */
+
+#include <glob.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "lkc.h"
+
+#define CACHE_MAGIC	0x4b43574f	/* "OWCK" */
+#define CACHE_VERSION	1
+
+/* symbol references: 0 is NULL, then the three constant symbols */
+#define REF_SYM_YES	1
+#define REF_SYM_MOD	2
+#define REF_SYM_NO	3
+#define REF_SYM_FIRST	4
+
+enum cache_dep_type {
+	CACHE_DEP_FILE = 1,
+	CACHE_DEP_ENV,
+	CACHE_DEP_SHELL,
+	CACHE_DEP_GLOB,
+};
+
+struct cache_dep {
+	struct cache_dep *next;
+	enum cache_dep_type type;
+	char *key;
+	char *aux;
+	char *val;
+};
+
+static struct cache_dep *dep_list;
+
+static uint64_t hash_buf(uint64_t hash, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+
+	/* fnv1a64 */
+	while (len--)
+		hash = (hash ^ *p++) * 0x100000001b3ULL;
+	return hash;
+}
+
+static void cache_add_dep(enum cache_dep_type type, const char *key,
+			  const char *aux, const char *val)
+{
+	struct cache_dep *dep;
+
+	for (dep = dep_list; dep; dep = dep->next)
+		if (dep->type == type && !strcmp(dep->key, key) &&
+		    !strcmp(dep->aux ?: "", aux ?: ""))
+			return;
+
+	dep = xcalloc(1, sizeof(*dep));
+	dep->type = type;
+	dep->key = xstrdup(key);
+	dep->aux = aux ? xstrdup(aux) : NULL;
+	dep->val = val ? xstrdup(val) : NULL;
+	dep->next = dep_list;
+	dep_list = dep;
+}
+
+void conf_cache_add_env(const char *name, const char *value)
+{
+	cache_add_dep(CACHE_DEP_ENV, name, NULL, value);
+}
+
+void conf_cache_add_shell(const char *cmd, const char *output)
+{
+	cache_add_dep(CACHE_DEP_SHELL, cmd, NULL, output);
+}
+
+static char *join_paths(size_t n, char **paths)
+{
+	struct gstr gs = str_new();
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		str_append(&gs, paths[i]);
+		str_append(&gs, "\n");
+	}
+	return gs.s;
+}
+
+void conf_cache_add_glob(const char *pattern, const char *curname,
+			 size_t n, char **paths)
+{
+	char *val = join_paths(n, paths);
+
+	cache_add_dep(CACHE_DEP_GLOB, pattern, curname, val);
+	free(val);
+}
+
+/*
+ * Resolve a 'source' pattern the same way zconf_nextfile() does.  Returns
+ * NULL if the pattern fails to resolve.
+ */
+static char *resolve_glob(const char *pattern, const char *curname)
+{
+	char path[PATH_MAX], *p, *ret;
+	glob_t gl;
+	int err;
+
+	err = glob(pattern, GLOB_ERR | GLOB_MARK, NULL, &gl);
+	if (err == GLOB_NOMATCH && strchr(pattern, '*'))
+		return xstrdup("");
+
+	if (err == GLOB_NOMATCH && curname) {
+		p = xstrdup(curname);
+		snprintf(path, sizeof(path), "%s/%s", dirname(p), pattern);
+		free(p);
+		err = glob(path, GLOB_ERR | GLOB_MARK, NULL, &gl);
+	}
+	if (err)
+		return NULL;
+
+	ret = join_paths(gl.gl_pathc, gl.gl_pathv);
+	globfree(&gl);
+	return ret;
+}
+
+/* Returns the hash of the file contents as a string, NULL if unreadable */
+static char *hash_file(const char *name)
+{
+	char buf[65536], *ret;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t len, total = 0;
+	FILE *f;
+
+	f = zconf_fopen(name);
+	if (!f)
+		return NULL;
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		hash = hash_buf(hash, buf, len);
+		total += len;
+	}
+	if (ferror(f)) {
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+
+	ret = xmalloc(40);
+	snprintf(ret, 40, "%zu:%016llx", total, (unsigned long long)hash);
+	return ret;
+}
+
+static bool str_eq(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+	return !strcmp(a, b);
+}
+
+static bool cache_dep_valid(enum cache_dep_type type, const char *key,
+			    const char *aux, const char *val)
+{
+	char *cur;
+	bool ret;
+
+	switch (type) {
+	case CACHE_DEP_ENV:
+		return str_eq(getenv(key), val);
+	case CACHE_DEP_FILE:
+		cur = hash_file(key);
+		break;
+	case CACHE_DEP_SHELL:
+		cur = shell_output(key);
+		break;
+	case CACHE_DEP_GLOB:
+		cur = resolve_glob(key, aux);
+		break;
+	default:
+		return false;
+	}
+
+	ret = str_eq(cur, val);
+	free(cur);
+	return ret;
+}
+
+/*
+ * Pointer to index table used while writing the cache.  Objects are kept in
+ * insertion order, references are written as index + 1 with 0 meaning NULL.
+ */
+struct obj_table {
+	const void **obj;
+	size_t count, alloc;
+	const void **hkey;
+	uint32_t *hval;
+	size_t hsize;
+};
+
+static size_t ptr_hash(const void *p, size_t size)
+{
+	uintptr_t v = (uintptr_t)p;
+
+	v ^= v >> 17;
+	v *= 0x9e3779b97f4a7c15ULL;
+	return (v >> 24) & (size - 1);
+}
+
+static uint32_t obj_find(struct obj_table *t, const void *p)
+{
+	size_t i;
+
+	if (!p || !t->hsize)
+		return 0;
+	for (i = ptr_hash(p, t->hsize); t->hkey[i]; i = (i + 1) & (t->hsize - 1))
+		if (t->hkey[i] == p)
+			return t->hval[i];
+	return 0;
+}
+
+static void obj_rehash(struct obj_table *t)
+{
+	size_t i, j;
+
+	free(t->hkey);
+	free(t->hval);
+	t->hsize = t->hsize ? t->hsize * 2 : 4096;
+	t->hkey = xcalloc(t->hsize, sizeof(*t->hkey));
+	t->hval = xcalloc(t->hsize, sizeof(*t->hval));
+	for (i = 0; i < t->count; i++) {
+		j = ptr_hash(t->obj[i], t->hsize);
+		while (t->hkey[j])
+			j = (j + 1) & (t->hsize - 1);
+		t->hkey[j] = t->obj[i];
+		t->hval[j] = i + 1;
+	}
+}
+
+/* Returns true if the object was not in the table yet */
+static bool obj_add(struct obj_table *t, const void *p)
+{
+	if (!p || obj_find(t, p))
+		return false;
+
+	if (t->count == t->alloc) {
+		t->alloc = t->alloc ? t->alloc * 2 : 4096;
+		t->obj = xrealloc(t->obj, t->alloc * sizeof(*t->obj));
+	}
+	t->obj[t->count++] = p;
+	if (t->count * 2 > t->hsize)
+		obj_rehash(t);
+	else {
+		size_t i = ptr_hash(p, t->hsize);
+
+		while (t->hkey[i])
+			i = (i + 1) & (t->hsize - 1);
+		t->hkey[i] = p;
+		t->hval[i] = t->count;
+	}
+	return true;
+}
+
+static void obj_free(struct obj_table *t)
+{
+	free(t->obj);
+	free(t->hkey);
+	free(t->hval);
+}
+
+struct cache_writer {
+	FILE *out;
+	bool err;
+	struct obj_table files, syms, props, menus, exprs;
+};
+
+static void w_u32(struct cache_writer *w, uint32_t v)
+{
+	if (fwrite(&v, sizeof(v), 1, w->out) != 1)
+		w->err = true;
+}
+
+static void w_str(struct cache_writer *w, const char *s)
+{
+	uint32_t len = s ? strlen(s) + 1 : 0;
+
+	w_u32(w, len);
+	if (len && fwrite(s, len, 1, w->out) != 1)
+		w->err = true;
+}
+
+static uint32_t w_ref(struct cache_writer *w, struct obj_table *t,
+		      const void *p)
+{
+	uint32_t ref = obj_find(t, p);
+
+	if (p && !ref)
+		w->err = true;
+	return ref;
+}
+
+static void w_sym(struct cache_writer *w, struct symbol *sym)
+{
+	uint32_t ref;
+
+	if (!sym)
+		ref = 0;
+	else if (sym == &symbol_yes)
+		ref = REF_SYM_YES;
+	else if (sym == &symbol_mod)
+		ref = REF_SYM_MOD;
+	else if (sym == &symbol_no)
+		ref = REF_SYM_NO;
+	else
+		ref = w_ref(w, &w->syms, sym) + REF_SYM_FIRST - 1;
+	w_u32(w, ref);
+}
+
+static void collect_expr(struct cache_writer *w, struct expr *e)
+{
+	while (e && obj_add(&w->exprs, e)) {
+		switch (e->type) {
+		case E_OR:
+		case E_AND:
+			collect_expr(w, e->right.expr);
+			/* fall through */
+		case E_NOT:
+		case E_LIST:
+			e = e->left.expr;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+static void collect_props(struct cache_writer *w, struct property *prop)
+{
+	for (; prop && obj_add(&w->props, prop); prop = prop->next) {
+		collect_expr(w, prop->visible.expr);
+		collect_expr(w, prop->expr);
+	}
+}
+
+static void collect_menu(struct cache_writer *w, struct menu *menu)
+{
+	struct menu *child;
+
+	obj_add(&w->menus, menu);
+	collect_props(w, menu->prompt);
+	collect_expr(w, menu->visibility);
+	collect_expr(w, menu->dep);
+	for (child = menu->list; child; child = child->next)
+		collect_menu(w, child);
+}
+
+static void write_expr(struct cache_writer *w, struct expr *e)
+{
+	w_u32(w, e->type);
+	switch (e->type) {
+	case E_OR:
+	case E_AND:
+		w_u32(w, w_ref(w, &w->exprs, e->left.expr));
+		w_u32(w, w_ref(w, &w->exprs, e->right.expr));
+		break;
+	case E_NOT:
+		w_u32(w, w_ref(w, &w->exprs, e->left.expr));
+		w_u32(w, 0);
+		break;
+	case E_LIST:
+		w_u32(w, w_ref(w, &w->exprs, e->left.expr));
+		w_sym(w, e->right.sym);
+		break;
+	case E_SYMBOL:
+		w_sym(w, e->left.sym);
+		w_u32(w, 0);
+		break;
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+	case E_RANGE:
+		w_sym(w, e->left.sym);
+		w_sym(w, e->right.sym);
+		break;
+	default:
+		w_u32(w, 0);
+		w_u32(w, 0);
+		break;
+	}
+}
+
+static void write_expr_value(struct cache_writer *w, struct expr_value *ev)
+{
+	w_u32(w, w_ref(w, &w->exprs, ev->expr));
+	w_u32(w, ev->tri);
+}
+
+static void write_tree(struct cache_writer *w, const char *name)
+{
+	struct cache_dep *dep;
+	struct symbol *sym;
+	struct file *file;
+	uint32_t ndeps = 0;
+	size_t i;
+	int bucket;
+
+	for (file = file_list; file; file = file->next) {
+		char *hash = hash_file(file->name);
+
+		if (!hash) {
+			w->err = true;
+			return;
+		}
+		cache_add_dep(CACHE_DEP_FILE, file->name, NULL, hash);
+		free(hash);
+		obj_add(&w->files, file);
+	}
+	cache_add_dep(CACHE_DEP_ENV, SRCTREE, NULL, getenv(SRCTREE));
+
+	for_all_symbols(bucket, sym) {
+		obj_add(&w->syms, sym);
+		collect_props(w, sym->prop);
+		collect_expr(w, sym->dir_dep.expr);
+		collect_expr(w, sym->rev_dep.expr);
+		collect_expr(w, sym->implied.expr);
+	}
+	collect_menu(w, &rootmenu);
+
+	w_u32(w, CACHE_MAGIC);
+	w_u32(w, CACHE_VERSION);
+	w_str(w, name);
+	w_u32(w, recursive_is_error);
+
+	for (dep = dep_list; dep; dep = dep->next)
+		ndeps++;
+	w_u32(w, ndeps);
+	for (dep = dep_list; dep; dep = dep->next) {
+		w_u32(w, dep->type);
+		w_str(w, dep->key);
+		w_str(w, dep->aux);
+		w_str(w, dep->val);
+	}
+
+	w_u32(w, w->files.count);
+	w_u32(w, w->syms.count);
+	w_u32(w, w->props.count);
+	w_u32(w, w->menus.count);
+	w_u32(w, w->exprs.count);
+	w_sym(w, modules_sym);
+
+	for (i = 0; i < w->files.count; i++) {
+		const struct file *f = w->files.obj[i];
+
+		w_str(w, f->name);
+		w_u32(w, w_ref(w, &w->files, f->parent));
+		w_u32(w, f->lineno);
+	}
+
+	for_all_symbols(bucket, sym) {
+		w_u32(w, bucket);
+		w_str(w, sym->name);
+		w_u32(w, sym->type);
+		w_u32(w, sym->flags);
+		w_u32(w, sym->visible);
+		w_u32(w, sym->curr.tri);
+		if (sym->curr.val && sym->curr.val != sym->name)
+			w->err = true;
+		w_u32(w, sym->curr.val != NULL);
+		w_u32(w, w_ref(w, &w->props, sym->prop));
+		write_expr_value(w, &sym->dir_dep);
+		write_expr_value(w, &sym->rev_dep);
+		write_expr_value(w, &sym->implied);
+		for (i = 0; i < S_DEF_COUNT; i++)
+			if (sym->def[i].val || sym->def[i].tri)
+				w->err = true;
+	}
+
+	for (i = 0; i < w->props.count; i++) {
+		const struct property *prop = w->props.obj[i];
+
+		w_u32(w, w_ref(w, &w->props, prop->next));
+		w_u32(w, prop->type);
+		w_str(w, prop->text);
+		write_expr_value(w, (struct expr_value *)&prop->visible);
+		w_u32(w, w_ref(w, &w->exprs, prop->expr));
+		w_u32(w, w_ref(w, &w->menus, prop->menu));
+		w_u32(w, w_ref(w, &w->files, prop->file));
+		w_u32(w, prop->lineno);
+	}
+
+	for (i = 0; i < w->menus.count; i++) {
+		const struct menu *menu = w->menus.obj[i];
+
+		w_u32(w, w_ref(w, &w->menus, menu->next));
+		w_u32(w, w_ref(w, &w->menus, menu->parent));
+		w_u32(w, w_ref(w, &w->menus, menu->list));
+		w_sym(w, menu->sym);
+		w_u32(w, w_ref(w, &w->props, menu->prompt));
+		w_u32(w, w_ref(w, &w->exprs, menu->visibility));
+		w_u32(w, w_ref(w, &w->exprs, menu->dep));
+		w_u32(w, menu->flags);
+		w_str(w, menu->help);
+		w_u32(w, w_ref(w, &w->files, menu->file));
+		w_u32(w, menu->lineno);
+	}
+
+	for (i = 0; i < w->exprs.count; i++)
+		write_expr(w, (struct expr *)w->exprs.obj[i]);
+}
+
+static void conf_cache_save(const char *path, const char *name)
+{
+	struct cache_writer w = {};
+	char tmpname[PATH_MAX];
+
+	snprintf(tmpname, sizeof(tmpname), "%s.%d.tmp", path, (int)getpid());
+	w.out = fopen(tmpname, "w");
+	if (!w.out)
+		return;
+
+	write_tree(&w, name);
+	if (fclose(w.out))
+		w.err = true;
+
+	if (w.err || rename(tmpname, path))
+		unlink(tmpname);
+
+	obj_free(&w.files);
+	obj_free(&w.syms);
+	obj_free(&w.props);
+	obj_free(&w.menus);
+	obj_free(&w.exprs);
+}
+
+struct cache_reader {
+	char *p, *end;
+	bool err;
+	uint32_t nfiles, nsyms, nprops, nmenus, nexprs;
+	struct file *files;
+	struct symbol *syms;
+	struct property *props;
+	struct menu *menus;
+	struct expr *exprs;
+};
+
+static uint32_t r_u32(struct cache_reader *r)
+{
+	uint32_t v;
+
+	if ((size_t)(r->end - r->p) < sizeof(v)) {
+		r->err = true;
+		return 0;
+	}
+	memcpy(&v, r->p, sizeof(v));
+	r->p += sizeof(v);
+	return v;
+}
+
+static char *r_str(struct cache_reader *r)
+{
+	uint32_t len = r_u32(r);
+	char *s = r->p;
+
+	if (!len)
+		return NULL;
+	if ((size_t)(r->end - r->p) < len || s[len - 1]) {
+		r->err = true;
+		return NULL;
+	}
+	r->p += len;
+	return s;
+}
+
+static void *r_obj(struct cache_reader *r, void *base, size_t size,
+		   uint32_t count)
+{
+	uint32_t ref = r_u32(r);
+
+	if (!ref || r->err)
+		return NULL;
+	if (ref > count) {
+		r->err = true;
+		return NULL;
+	}
+	return (char *)base + (ref - 1) * size;
+}
+
+#define r_file(r)	r_obj(r, (r)->files, sizeof(struct file), (r)->nfiles)
+#define r_prop(r)	r_obj(r, (r)->props, sizeof(struct property), (r)->nprops)
+#define r_menu(r)	r_obj(r, (r)->menus, sizeof(struct menu), (r)->nmenus)
+#define r_expr(r)	r_obj(r, (r)->exprs, sizeof(struct expr), (r)->nexprs)
+
+static struct symbol *r_sym(struct cache_reader *r)
+{
+	uint32_t ref = r_u32(r);
+
+	switch (ref) {
+	case 0:
+		return NULL;
+	case REF_SYM_YES:
+		return &symbol_yes;
+	case REF_SYM_MOD:
+		return &symbol_mod;
+	case REF_SYM_NO:
+		return &symbol_no;
+	}
+	if (ref - REF_SYM_FIRST >= r->nsyms) {
+		r->err = true;
+		return NULL;
+	}
+	return &r->syms[ref - REF_SYM_FIRST];
+}
+
+static void read_expr_value(struct cache_reader *r, struct expr_value *ev)
+{
+	ev->expr = r_expr(r);
+	ev->tri = r_u32(r);
+}
+
+static void read_expr(struct cache_reader *r, struct expr *e)
+{
+	e->type = r_u32(r);
+	switch (e->type) {
+	case E_OR:
+	case E_AND:
+		e->left.expr = r_expr(r);
+		e->right.expr = r_expr(r);
+		break;
+	case E_NOT:
+		e->left.expr = r_expr(r);
+		r_u32(r);
+		break;
+	case E_LIST:
+		e->left.expr = r_expr(r);
+		e->right.sym = r_sym(r);
+		break;
+	case E_SYMBOL:
+		e->left.sym = r_sym(r);
+		r_u32(r);
+		break;
+	default:
+		e->left.sym = r_sym(r);
+		e->right.sym = r_sym(r);
+		break;
+	}
+}
+
+static bool read_deps(struct cache_reader *r, const char *name)
+{
+	uint32_t i, ndeps;
+	char *key, *aux, *val;
+	int type;
+
+	if (r_u32(r) != CACHE_MAGIC || r_u32(r) != CACHE_VERSION)
+		return false;
+	if (!str_eq(r_str(r), name) || r_u32(r) != recursive_is_error)
+		return false;
+
+	ndeps = r_u32(r);
+	for (i = 0; i < ndeps && !r->err; i++) {
+		type = r_u32(r);
+		key = r_str(r);
+		aux = r_str(r);
+		val = r_str(r);
+		if (r->err || !key || !cache_dep_valid(type, key, aux, val))
+			return false;
+	}
+	return !r->err;
+}
+
+static bool read_tree(struct cache_reader *r)
+{
+	struct symbol *hash[SYMBOL_HASHSIZE], **tail[SYMBOL_HASHSIZE];
+	struct symbol *modules;
+	struct menu root;
+	uint32_t i, j, bucket;
+
+	r->nfiles = r_u32(r);
+	r->nsyms = r_u32(r);
+	r->nprops = r_u32(r);
+	r->nmenus = r_u32(r);
+	r->nexprs = r_u32(r);
+	if (r->err || !r->nmenus)
+		return false;
+
+	r->files = xcalloc(r->nfiles, sizeof(*r->files));
+	r->syms = xcalloc(r->nsyms, sizeof(*r->syms));
+	r->props = xcalloc(r->nprops, sizeof(*r->props));
+	r->menus = xcalloc(r->nmenus, sizeof(*r->menus));
+	r->exprs = xcalloc(r->nexprs, sizeof(*r->exprs));
+
+	modules = r_sym(r);
+
+	for (i = 0; i < r->nfiles; i++) {
+		struct file *f = &r->files[i];
+
+		f->next = i + 1 < r->nfiles ? &r->files[i + 1] : NULL;
+		f->name = r_str(r);
+		f->parent = r_file(r);
+		f->lineno = r_u32(r);
+	}
+
+	for (i = 0; i < SYMBOL_HASHSIZE; i++) {
+		hash[i] = NULL;
+		tail[i] = &hash[i];
+	}
+	for (i = 0; i < r->nsyms && !r->err; i++) {
+		struct symbol *sym = &r->syms[i];
+
+		bucket = r_u32(r);
+		if (bucket >= SYMBOL_HASHSIZE) {
+			r->err = true;
+			break;
+		}
+		*tail[bucket] = sym;
+		tail[bucket] = &sym->next;
+
+		sym->name = r_str(r);
+		sym->type = r_u32(r);
+		sym->flags = r_u32(r);
+		sym->visible = r_u32(r);
+		sym->curr.tri = r_u32(r);
+		sym->curr.val = r_u32(r) ? sym->name : NULL;
+		sym->prop = r_prop(r);
+		read_expr_value(r, &sym->dir_dep);
+		read_expr_value(r, &sym->rev_dep);
+		read_expr_value(r, &sym->implied);
+	}
+
+	for (i = 0; i < r->nprops; i++) {
+		struct property *prop = &r->props[i];
+
+		prop->next = r_prop(r);
+		prop->type = r_u32(r);
+		prop->text = r_str(r);
+		read_expr_value(r, &prop->visible);
+		prop->expr = r_expr(r);
+		prop->menu = r_menu(r);
+		prop->file = r_file(r);
+		prop->lineno = r_u32(r);
+	}
+
+	for (i = 0; i < r->nmenus; i++) {
+		struct menu *menu = &r->menus[i];
+
+		menu->next = r_menu(r);
+		menu->parent = r_menu(r);
+		menu->list = r_menu(r);
+		menu->sym = r_sym(r);
+		menu->prompt = r_prop(r);
+		menu->visibility = r_expr(r);
+		menu->dep = r_expr(r);
+		menu->flags = r_u32(r);
+		menu->help = r_str(r);
+		menu->file = r_file(r);
+		menu->lineno = r_u32(r);
+	}
+
+	for (i = 0; i < r->nexprs; i++)
+		read_expr(r, &r->exprs[i]);
+
+	if (r->err || r->p != r->end)
+		return false;
+
+	/*
+	 * The first menu is the root menu, which lives in menu.c. Redirect
+	 * all references to the loaded copy before installing it.
+	 */
+	root = r->menus[0];
+	for (i = 0; i < r->nmenus; i++) {
+		struct menu *menu = &r->menus[i];
+
+		if (menu->parent == &r->menus[0])
+			menu->parent = &rootmenu;
+		if (menu->next == &r->menus[0] || menu->list == &r->menus[0])
+			return false;
+	}
+	for (i = 0; i < r->nprops; i++)
+		if (r->props[i].menu == &r->menus[0])
+			r->props[i].menu = &rootmenu;
+
+	rootmenu = root;
+	file_list = r->nfiles ? &r->files[0] : NULL;
+	modules_sym = modules;
+	for (j = 0; j < SYMBOL_HASHSIZE; j++)
+		symbol_hash[j] = hash[j];
+
+	return true;
+}
+
+static bool conf_cache_load(const char *path, const char *name)
+{
+	struct cache_reader r = {};
+	struct stat st;
+	char *buf;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return false;
+	if (fstat(fileno(f), &st) || !st.st_size) {
+		fclose(f);
+		return false;
+	}
+
+	buf = xmalloc(st.st_size);
+	if (fread(buf, st.st_size, 1, f) != 1) {
+		fclose(f);
+		free(buf);
+		return false;
+	}
+	fclose(f);
+
+	r.p = buf;
+	r.end = buf + st.st_size;
+	if (read_deps(&r, name) && read_tree(&r)) {
+		/* strings are referenced from buf, keep it around */
+		conf_set_changed(true);
+		return true;
+	}
+
+	free(r.files);
+	free(r.syms);
+	free(r.props);
+	free(r.menus);
+	free(r.exprs);
+	free(buf);
+	return false;
+}
+
+/*
+ * Parse the Kconfig tree in 'name', using the cache file named by
+ * KCONFIG_CACHE if it is set and all recorded inputs are unchanged.
+ */
+void conf_parse_cached(const char *name)
+{
+	const char *path = getenv("KCONFIG_CACHE");
+
+	if (!path || !*path) {
+		conf_parse(name);
+		return;
+	}
+
+	if (conf_cache_load(path, name))
+		return;
+
+	conf_parse(name);
+	conf_cache_save(path, name);
+}
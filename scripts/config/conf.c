@@ -36,6 +36,7 @@ enum input_mode {
 	yes2modconfig,
 	mod2yesconfig,
 	fatalrecursive,
+	batch,
 };
 static enum input_mode input_mode = oldaskconfig;
 static int input_mode_opt;
@@ -698,9 +699,93 @@ static const struct option long_opts[] = {
 	{"yes2modconfig", no_argument,       &input_mode_opt, yes2modconfig},
 	{"mod2yesconfig", no_argument,       &input_mode_opt, mod2yesconfig},
 	{"fatalrecursive",no_argument,       NULL, fatalrecursive},
+	{"batch",         required_argument, NULL, batch},
 	{NULL, 0, NULL, 0}
 };
 
+/*
+ * Apply a list of operations to the configuration without parsing the
+ * Kconfig tree again for each of them.  One operation per line, empty lines
+ * and lines starting with '#' are ignored:
+ *
+ *   read <file>          load <file> (resets all previous user values)
+ *   defconfig <file>     load <file> and set new symbols to their default
+ *   alldefconfig         set new symbols to their default
+ *   allnoconfig          set new symbols to 'n'
+ *   allyesconfig         set new symbols to 'y'
+ *   allmodconfig         set new symbols to 'm'
+ *   olddefconfig         no-op, values are recalculated on write
+ *   write [<file>]       write the configuration, .config by default
+ *   savedefconfig <file> write the minimal configuration to <file>
+ */
+static int conf_batch(const char *batch_file)
+{
+	FILE *in = stdin;
+	char *cmd, *arg;
+	int lineno = 0;
+	int ret = 0;
+
+	if (strcmp(batch_file, "-")) {
+		in = fopen(batch_file, "r");
+		if (!in) {
+			perror(batch_file);
+			return 1;
+		}
+	}
+
+	while (!ret && fgets(line, sizeof(line), in)) {
+		lineno++;
+		strip(line);
+		if (!line[0] || line[0] == '#')
+			continue;
+
+		cmd = line;
+		arg = strpbrk(line, " \t");
+		if (arg) {
+			*arg++ = 0;
+			strip(arg);
+		}
+		if (arg && !*arg)
+			arg = NULL;
+
+		if (!strcmp(cmd, "read") && arg) {
+			ret = conf_read(arg);
+		} else if (!strcmp(cmd, "defconfig") && arg) {
+			ret = conf_read(arg);
+			if (!ret)
+				conf_set_all_new_symbols(def_default);
+		} else if (!strcmp(cmd, "alldefconfig")) {
+			conf_set_all_new_symbols(def_default);
+		} else if (!strcmp(cmd, "allnoconfig")) {
+			conf_set_all_new_symbols(def_no);
+		} else if (!strcmp(cmd, "allyesconfig")) {
+			conf_set_all_new_symbols(def_yes);
+		} else if (!strcmp(cmd, "allmodconfig")) {
+			conf_set_all_new_symbols(def_mod);
+		} else if (!strcmp(cmd, "olddefconfig")) {
+			;
+		} else if (!strcmp(cmd, "write")) {
+			ret = conf_write(arg);
+		} else if (!strcmp(cmd, "savedefconfig") && arg) {
+			ret = conf_write_defconfig(arg);
+		} else {
+			fprintf(stderr, "%s:%d: invalid operation '%s'\n",
+				batch_file, lineno, cmd);
+			ret = 1;
+			break;
+		}
+
+		if (ret)
+			fprintf(stderr, "%s:%d: '%s' failed\n",
+				batch_file, lineno, cmd);
+	}
+
+	if (in != stdin)
+		fclose(in);
+
+	return ret;
+}
+
 static void conf_usage(const char *progname)
 {
 	printf("Usage: %s [options] <kconfig-file>\n", progname);
@@ -709,6 +794,8 @@ static void conf_usage(const char *progname)
 	printf("  -h, --help              Print this message and exit.\n");
 	printf("  -s, --silent            Do not print log.\n");
 	printf("      --fatalrecursive    Treat recursive depenendencies as a fatal error\n");
+	printf("      --batch <file>      Apply the operations listed in <file> ('-' for stdin)\n"
+	       "                          in one run, see conf_batch() for the syntax\n");
 	printf("\n");
 	printf("Mode options:\n");
 	printf("  --listnewconfig         List new options\n");
@@ -736,6 +823,7 @@ int main(int ac, char **av)
 	int opt;
 	const char *name, *defconfig_file = NULL /* gcc uninit */;
 	const char *input_file = NULL, *output_file = NULL;
+	const char *batch_file = NULL;
 	int no_conf_write = 0;
 
 	tty_stdio = isatty(0) && isatty(1);
@@ -752,6 +840,9 @@ int main(int ac, char **av)
 		case fatalrecursive:
 			recursive_is_error = 1;
 			continue;
+		case batch:
+			batch_file = optarg;
+			continue;
 		case 'r':
 			input_file = optarg;
 			break;
@@ -789,9 +880,12 @@ int main(int ac, char **av)
 		conf_usage(progname);
 		exit(1);
 	}
-	conf_parse(av[optind]);
+	conf_parse_cached(av[optind]);
 	//zconfdump(stdout);
 
+	if (batch_file)
+		return conf_batch(batch_file);
+
 	switch (input_mode) {
 	case defconfig:
 		if (conf_read(defconfig_file)) {
@@ -368,12 +368,60 @@ void conf_reset(int def)
 	}
 }
 
+/*
+ * Split a line of a .config file in place.  *name is set to the symbol name
+ * without 'prefix', *val to the value for "<prefix>FOO=val" lines and to NULL
+ * for "# <prefix>FOO is not set" lines.
+ */
+enum conf_line conf_split_line(char *line, const char *prefix,
+			       char **name, char **val)
+{
+	size_t len = strlen(prefix);
+	char *p;
+
+	if (line[0] == '#') {
+		if (strncmp(line + 2, prefix, len))
+			return CONF_LINE_SKIP;
+		p = strchr(line + 2 + len, ' ');
+		if (!p)
+			return CONF_LINE_SKIP;
+		*p++ = 0;
+		if (strncmp(p, "is not set", 10))
+			return CONF_LINE_SKIP;
+		*name = line + 2 + len;
+		*val = NULL;
+		return CONF_LINE_UNSET;
+	}
+
+	if (strncmp(line, prefix, len)) {
+		if (line[0] != '\r' && line[0] != '\n' && line[0])
+			return CONF_LINE_INVALID;
+		return CONF_LINE_SKIP;
+	}
+
+	p = strchr(line + len, '=');
+	if (!p)
+		return CONF_LINE_SKIP;
+	*p++ = 0;
+	*name = line + len;
+	*val = p;
+
+	p = strchr(p, '\n');
+	if (p) {
+		*p-- = 0;
+		if (*p == '\r')
+			*p = 0;
+	}
+
+	return CONF_LINE_VALUE;
+}
+
 int conf_read_simple(const char *name, int def)
 {
 	FILE *in = NULL;
 	char   *line = NULL;
 	size_t  line_asize = 0;
-	char *p, *p2;
+	char *p, *symname, *val;
 	struct symbol *sym;
 	int def_flags;
 
@@ -436,23 +484,16 @@ load:
 	while (compat_getline(&line, &line_asize, in) != -1) {
 		conf_lineno++;
 		sym = NULL;
-		if (line[0] == '#') {
-			if (memcmp(line + 2, CONFIG_, strlen(CONFIG_)))
-				continue;
-			p = strchr(line + 2 + strlen(CONFIG_), ' ');
-			if (!p)
-				continue;
-			*p++ = 0;
-			if (strncmp(p, "is not set", 10))
-				continue;
+		switch (conf_split_line(line, CONFIG_, &symname, &val)) {
+		case CONF_LINE_UNSET:
 			if (def == S_DEF_USER) {
-				sym = sym_find(line + 2 + strlen(CONFIG_));
+				sym = sym_find(symname);
 				if (!sym) {
 					conf_set_changed(true);
 					continue;
 				}
 			} else {
-				sym = sym_lookup(line + 2 + strlen(CONFIG_), 0);
+				sym = sym_lookup(symname, 0);
 				if (sym->type == S_UNKNOWN)
 					sym->type = S_BOOLEAN;
 			}
@@ -465,19 +506,9 @@ load:
 			default:
 				;
 			}
-		} else if (memcmp(line, CONFIG_, strlen(CONFIG_)) == 0) {
-			p = strchr(line + strlen(CONFIG_), '=');
-			if (!p)
-				continue;
-			*p++ = 0;
-			p2 = strchr(p, '\n');
-			if (p2) {
-				*p2-- = 0;
-				if (*p2 == '\r')
-					*p2 = 0;
-			}
-
-			sym = sym_find(line + strlen(CONFIG_));
+			break;
+		case CONF_LINE_VALUE:
+			sym = sym_find(symname);
 			if (!sym) {
 				if (def == S_DEF_AUTO)
 					/*
@@ -486,19 +517,20 @@ load:
 					 * auto.conf but it is missing now,
 					 * include/config/FOO must be touched.
 					 */
-					conf_touch_dep(line + strlen(CONFIG_));
+					conf_touch_dep(symname);
 				else
 					conf_set_changed(true);
 				continue;
 			}
 
-			if (conf_set_sym_val(sym, def, def_flags, p))
+			if (conf_set_sym_val(sym, def, def_flags, val))
 				continue;
-		} else {
-			if (line[0] != '\r' && line[0] != '\n')
-				conf_warning("unexpected data: %.*s",
-					     (int)strcspn(line, "\r\n"), line);
-
+			break;
+		case CONF_LINE_INVALID:
+			conf_warning("unexpected data: %.*s",
+				     (int)strcspn(line, "\r\n"), line);
+			continue;
+		default:
 			continue;
 		}
 
@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Native implementation of the scripts/kconfig.pl expression language.
+ *
+ * Usage: kconfig-merge [-n] [-p <prefix>] [--explain] <expr>
+ *
+ * <expr> is written in prefix notation, like for kconfig.pl:
+ *   <file>          load a config file
+ *   + a b           a, with the values of b added or overriding
+ *   m+ a b          like +, but 'y' is never downgraded and a
+ *                   '# FOO is not set' in b does not override a
+ *   & a b           symbols set to the same value in both a and b
+ *   > a b           symbols from b that are missing or different in a
+ *   >+ a b          like >, ignoring unset symbols missing in a
+ *   - a b           a without the symbols in b, which may be regular
+ *                   expressions
+ *
+ * Chains of '+' as generated for the kernel config merges are evaluated by
+ * reading each fragment once into the same table.  With --explain, each
+ * output line is followed by the fragment and line that set the value, and
+ * the value it replaced.
+ *
+ * Patterns for '-' are POSIX extended regular expressions; patterns that
+ * need Perl extensions (e.g. lookahead) are rejected.
+ */
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lkc.h"
+
+#define UNDEF_VAL	"#undef"
+
+struct kconf_entry {
+	const char *name;
+	const char *val;
+	const char *file;
+	int lineno;
+	/* entry replaced by this one, for --explain */
+	struct kconf_entry *prev;
+};
+
+struct kconf {
+	struct kconf_entry **tab;
+	size_t size, count;
+};
+
+static const char *prefix = "CONFIG_";
+static bool explain;
+static char **args;
+static int nargs, pos;
+
+static void __attribute__((noreturn)) die(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "kconfig-merge: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+	exit(1);
+}
+
+/* Perl truth value of a config value */
+static bool val_true(const char *val)
+{
+	return val && *val && strcmp(val, "0");
+}
+
+static unsigned int name_hash(const char *s)
+{
+	/* fnv32 hash */
+	unsigned int hash = 2166136261U;
+
+	for (; *s; s++)
+		hash = (hash ^ *s) * 0x01000193;
+	return hash;
+}
+
+static struct kconf *kconf_new(void)
+{
+	struct kconf *cfg = xcalloc(1, sizeof(*cfg));
+
+	cfg->size = 1024;
+	cfg->tab = xcalloc(cfg->size, sizeof(*cfg->tab));
+	return cfg;
+}
+
+static struct kconf_entry **kconf_slot(struct kconf *cfg, const char *name)
+{
+	size_t i = name_hash(name) & (cfg->size - 1);
+
+	while (cfg->tab[i] && strcmp(cfg->tab[i]->name, name))
+		i = (i + 1) & (cfg->size - 1);
+	return &cfg->tab[i];
+}
+
+static struct kconf_entry *kconf_get(struct kconf *cfg, const char *name)
+{
+	return *kconf_slot(cfg, name);
+}
+
+static void kconf_grow(struct kconf *cfg)
+{
+	struct kconf_entry **old = cfg->tab;
+	size_t i, size = cfg->size;
+
+	cfg->size *= 2;
+	cfg->tab = xcalloc(cfg->size, sizeof(*cfg->tab));
+	for (i = 0; i < size; i++)
+		if (old[i])
+			*kconf_slot(cfg, old[i]->name) = old[i];
+	free(old);
+}
+
+/* Entries are never modified once created, so they can be shared */
+static void kconf_set(struct kconf *cfg, struct kconf_entry *e)
+{
+	struct kconf_entry **slot;
+
+	if ((cfg->count + 1) * 2 > cfg->size)
+		kconf_grow(cfg);
+
+	slot = kconf_slot(cfg, e->name);
+	if (!*slot)
+		cfg->count++;
+	*slot = e;
+}
+
+static void kconf_del(struct kconf *cfg, const char *name)
+{
+	struct kconf_entry **slot = kconf_slot(cfg, name);
+	struct kconf_entry *e;
+	size_t i;
+
+	if (!*slot)
+		return;
+	*slot = NULL;
+	cfg->count--;
+
+	/* reinsert the rest of the cluster */
+	i = (slot - cfg->tab + 1) & (cfg->size - 1);
+	while ((e = cfg->tab[i])) {
+		cfg->tab[i] = NULL;
+		*kconf_slot(cfg, e->name) = e;
+		i = (i + 1) & (cfg->size - 1);
+	}
+}
+
+static struct kconf_entry *entry_new(const char *name, const char *val,
+				     const char *file, int lineno,
+				     struct kconf_entry *prev)
+{
+	struct kconf_entry *e = xmalloc(sizeof(*e));
+
+	e->name = name;
+	e->val = val;
+	e->file = file;
+	e->lineno = lineno;
+	e->prev = explain ? prev : NULL;
+	return e;
+}
+
+/* Add 'e' to cfg, following the config_add() rules of kconfig.pl */
+static void kconf_add(struct kconf *cfg, struct kconf_entry *e, bool mod_plus)
+{
+	struct kconf_entry *old = kconf_get(cfg, e->name);
+
+	if (old == e)
+		return;
+	if (mod_plus && old && val_true(old->val)) {
+		if (!strcmp(old->val, "y"))
+			return;
+		if (!strcmp(e->val, UNDEF_VAL))
+			return;
+	}
+	if (old && explain && e->prev != old)
+		e = entry_new(e->name, e->val, e->file, e->lineno, old);
+	kconf_set(cfg, e);
+}
+
+/*
+ * Load a config file, into 'cfg' if given (which makes chains of '+' a
+ * single pass over all fragments) or into a new table otherwise.
+ */
+static struct kconf *kconf_load(struct kconf *cfg, const char *file,
+				bool mod_plus)
+{
+	struct kconf_entry *old;
+	char *line = NULL, *name, *val;
+	size_t line_asize = 0;
+	int lineno = 0;
+	FILE *in;
+
+	in = fopen(file, "r");
+	if (!in)
+		die("can't open file '%s'", file);
+
+	if (!cfg)
+		cfg = kconf_new();
+
+	while (getline(&line, &line_asize, in) != -1) {
+		lineno++;
+		switch (conf_split_line(line, prefix, &name, &val)) {
+		case CONF_LINE_UNSET:
+			val = UNDEF_VAL;
+			break;
+		case CONF_LINE_VALUE:
+			if (!*name || !*val)
+				goto invalid;
+			break;
+		case CONF_LINE_INVALID:
+		invalid:
+			fprintf(stderr, "WARNING: can't parse line: %.*s\n",
+				(int)strcspn(line, "\r\n"), line);
+			/* fall through */
+		default:
+			continue;
+		}
+
+		old = kconf_get(cfg, name);
+		if (old && mod_plus && strcmp(old->val, UNDEF_VAL) &&
+		    strcmp(val, "y"))
+			continue;
+
+		kconf_set(cfg, entry_new(xstrdup(name), xstrdup(val), file,
+					 lineno, old));
+	}
+
+	free(line);
+	fclose(in);
+	return cfg;
+}
+
+static struct kconf *kconf_and(struct kconf *cfg1, struct kconf *cfg2)
+{
+	struct kconf *cfg = kconf_new();
+	struct kconf_entry *e1, *e2;
+	size_t i;
+
+	for (i = 0; i < cfg1->size; i++) {
+		e1 = cfg1->tab[i];
+		if (!e1)
+			continue;
+		e2 = kconf_get(cfg2, e1->name);
+		if (e2 && val_true(e2->val) && !strcmp(e1->val, e2->val))
+			kconf_set(cfg, e1);
+	}
+	return cfg;
+}
+
+static struct kconf *kconf_diff(struct kconf *cfg1, struct kconf *cfg2,
+				bool new_only)
+{
+	struct kconf *cfg = kconf_new();
+	struct kconf_entry *e1, *e2;
+	size_t i;
+
+	for (i = 0; i < cfg2->size; i++) {
+		e2 = cfg2->tab[i];
+		if (!e2)
+			continue;
+		e1 = kconf_get(cfg1, e2->name);
+		if (e1 && !strcmp(e1->val, e2->val))
+			continue;
+		if (new_only && !e1 && !strcmp(e2->val, UNDEF_VAL))
+			continue;
+		kconf_set(cfg, e2);
+	}
+	return cfg;
+}
+
+static struct kconf *kconf_sub(struct kconf *cfg1, struct kconf *cfg2)
+{
+	struct kconf_entry *e, **match;
+	size_t i, j, n;
+	regex_t re;
+	char *pat;
+
+	match = xmalloc((cfg1->count + 1) * sizeof(*match));
+	for (i = 0; i < cfg2->size; i++) {
+		e = cfg2->tab[i];
+		if (!e)
+			continue;
+		if (!strpbrk(e->name, "?.*")) {
+			kconf_del(cfg1, e->name);
+			continue;
+		}
+
+		pat = xmalloc(strlen(e->name) + 5);
+		sprintf(pat, "^(%s)$", e->name);
+		if (regcomp(&re, pat, REG_EXTENDED | REG_NOSUB))
+			die("%s:%d: unsupported pattern '%s'", e->file,
+			    e->lineno, e->name);
+		free(pat);
+
+		for (j = n = 0; j < cfg1->size; j++)
+			if (cfg1->tab[j] &&
+			    !regexec(&re, cfg1->tab[j]->name, 0, NULL, 0))
+				match[n++] = cfg1->tab[j];
+		for (j = 0; j < n; j++)
+			kconf_del(cfg1, match[j]->name);
+		regfree(&re);
+	}
+	free(match);
+	return cfg1;
+}
+
+static void kconf_add_all(struct kconf *cfg, struct kconf *src, bool mod_plus)
+{
+	size_t i;
+
+	for (i = 0; i < src->size; i++)
+		if (src->tab[i])
+			kconf_add(cfg, src->tab[i], mod_plus);
+}
+
+/*
+ * Evaluate the next expression.  If 'into' is given, the result is added to
+ * it as with '+' and 'into' is returned.
+ */
+static struct kconf *parse_expr(struct kconf *into, bool mod_plus)
+{
+	struct kconf *cfg1, *cfg2;
+	const char *arg;
+
+	if (pos >= nargs || !*args[pos])
+		die("Parse error");
+	arg = args[pos++];
+
+	if (arg[0] == '+') {
+		cfg1 = parse_expr(into, false);
+		return parse_expr(cfg1, false);
+	} else if (!strcmp(arg, "&")) {
+		cfg1 = parse_expr(NULL, false);
+		cfg2 = parse_expr(NULL, false);
+		cfg1 = kconf_and(cfg1, cfg2);
+	} else if (!strncmp(arg, "m+", 2)) {
+		cfg1 = parse_expr(NULL, false);
+		cfg2 = parse_expr(NULL, true);
+		kconf_add_all(cfg1, cfg2, true);
+	} else if (!strcmp(arg, ">") || !strcmp(arg, ">+")) {
+		cfg1 = parse_expr(NULL, false);
+		cfg2 = parse_expr(NULL, false);
+		cfg1 = kconf_diff(cfg1, cfg2, arg[1] == '+');
+	} else if (!strcmp(arg, "-")) {
+		cfg1 = parse_expr(NULL, false);
+		cfg2 = parse_expr(NULL, false);
+		cfg1 = kconf_sub(cfg1, cfg2);
+	} else {
+		return kconf_load(into, arg, mod_plus);
+	}
+
+	if (!into)
+		return cfg1;
+
+	kconf_add_all(into, cfg1, false);
+	return into;
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+	const struct kconf_entry *e1 = *(const struct kconf_entry **)a;
+	const struct kconf_entry *e2 = *(const struct kconf_entry **)b;
+
+	return strcmp(e1->name, e2->name);
+}
+
+static void print_entry(struct kconf_entry *e)
+{
+	struct kconf_entry *prev;
+
+	if (!strcmp(e->val, UNDEF_VAL) || !strcmp(e->val, "n"))
+		printf("# %s%s is not set\n", prefix, e->name);
+	else
+		printf("%s%s=%s\n", prefix, e->name, e->val);
+
+	if (!explain)
+		return;
+
+	printf("#\tset by %s:%d\n", e->file, e->lineno);
+	for (prev = e->prev; prev; prev = prev->prev)
+		printf("#\t  replaces %s from %s:%d\n",
+		       strcmp(prev->val, UNDEF_VAL) ? prev->val : "unset",
+		       prev->file, prev->lineno);
+}
+
+static void dump_config(struct kconf *cfg)
+{
+	struct kconf_entry **list;
+	size_t i, n = 0;
+
+	list = xmalloc((cfg->count + 1) * sizeof(*list));
+	for (i = 0; i < cfg->size; i++)
+		if (cfg->tab[i])
+			list[n++] = cfg->tab[i];
+	qsort(list, n, sizeof(*list), entry_cmp);
+
+	for (i = 0; i < n; i++)
+		print_entry(list[i]);
+	free(list);
+}
+
+int main(int argc, char **argv)
+{
+	struct kconf *cfg;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+		if (!strcmp(argv[i], "-n"))
+			prefix = "";
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			prefix = argv[++i];
+		else if (!strcmp(argv[i], "--explain"))
+			explain = true;
+		else
+			die("Invalid option: %s", argv[i]);
+	}
+
+	args = argv + i;
+	nargs = argc - i;
+
+	cfg = parse_expr(NULL, false);
+	if (pos < nargs)
+		die("Parse error");
+
+	dump_config(cfg);
+
+	return 0;
+}
@@ -4167,6 +4167,8 @@ void zconf_nextfile(const char *name)
 		exit(1);
 	}
 
+	conf_cache_add_glob(name, current_file->name, gl.gl_pathc, gl.gl_pathv);
+
 	for (i = 0; i < gl.gl_pathc; i++)
 		__zconf_nextfile(gl.gl_pathv[i]);
 }
@@ -40,6 +40,13 @@ int zconf_lineno(void);
 const char *zconf_curname(void);
 extern int recursive_is_error;
 
+/* cache.c */
+void conf_parse_cached(const char *name);
+void conf_cache_add_env(const char *name, const char *value);
+void conf_cache_add_shell(const char *cmd, const char *output);
+void conf_cache_add_glob(const char *pattern, const char *curname,
+			 size_t n, char **paths);
+
 /* confdata.c */
 const char *conf_get_configname(void);
 void set_all_choice_values(struct symbol *csym);
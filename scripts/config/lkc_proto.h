@@ -2,6 +2,14 @@
 #include <stdarg.h>
 
 /* confdata.c */
+enum conf_line {
+	CONF_LINE_SKIP,
+	CONF_LINE_INVALID,
+	CONF_LINE_VALUE,
+	CONF_LINE_UNSET,
+};
+enum conf_line conf_split_line(char *line, const char *prefix,
+			       char **name, char **val);
 void conf_parse(const char *name);
 int conf_read(const char *name);
 int conf_read_simple(const char *name, int);
@@ -48,6 +56,7 @@ void variable_add(const char *name, const char *value,
 void variable_all_del(void);
 char *expand_dollar(const char **str);
 char *expand_one_token(const char **str);
+char *shell_output(const char *cmd);
 
 /* expr.c */
 void expr_print(struct expr *e, void (*fn)(void *, struct symbol *, const char *), void *data, int prevtoken);
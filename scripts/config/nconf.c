@@ -1488,7 +1488,7 @@ int main(int ac, char **av)
 		conf_set_message_callback(NULL);
 		av++;
 	}
-	conf_parse(av[1]);
+	conf_parse_cached(av[1]);
 	conf_read(NULL);
 
 	mode = getenv("NCONFIG_MODE");
@@ -456,6 +456,149 @@ void sym_clear_all_valid(void)
 	sym_calc_value(modules_sym);
 }
 
+static void expr_walk_syms(struct expr *e, struct symbol *sym,
+			   void (*fn)(struct symbol *dep, struct symbol *sym))
+{
+	if (!e)
+		return;
+
+	switch (e->type) {
+	case E_OR:
+	case E_AND:
+		expr_walk_syms(e->left.expr, sym, fn);
+		expr_walk_syms(e->right.expr, sym, fn);
+		break;
+	case E_NOT:
+		expr_walk_syms(e->left.expr, sym, fn);
+		break;
+	case E_LIST:
+		expr_walk_syms(e->left.expr, sym, fn);
+		fn(e->right.sym, sym);
+		break;
+	case E_SYMBOL:
+		fn(e->left.sym, sym);
+		break;
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+	case E_RANGE:
+		fn(e->left.sym, sym);
+		fn(e->right.sym, sym);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Call fn() for every symbol read by sym_calc_value(sym) */
+static void sym_walk_deps(struct symbol *sym,
+			  void (*fn)(struct symbol *dep, struct symbol *sym))
+{
+	struct property *prop;
+
+	for (prop = sym->prop; prop; prop = prop->next) {
+		switch (prop->type) {
+		case P_SELECT:
+		case P_IMPLY:
+			/* only used for the rev_dep/implied of the target */
+			continue;
+		default:
+			break;
+		}
+		expr_walk_syms(prop->visible.expr, sym, fn);
+		expr_walk_syms(prop->expr, sym, fn);
+	}
+	expr_walk_syms(sym->dir_dep.expr, sym, fn);
+	expr_walk_syms(sym->rev_dep.expr, sym, fn);
+	expr_walk_syms(sym->implied.expr, sym, fn);
+}
+
+static void sym_count_rdep(struct symbol *dep, struct symbol *sym)
+{
+	if (dep != sym && !(dep->flags & SYMBOL_CONST))
+		dep->rdeps_count++;
+}
+
+static void sym_add_rdep(struct symbol *dep, struct symbol *sym)
+{
+	if (dep != sym && !(dep->flags & SYMBOL_CONST))
+		dep->rdeps[dep->rdeps_count++] = sym;
+}
+
+static void sym_build_rdeps(void)
+{
+	static bool rdeps_built;
+	struct symbol *sym;
+	int i;
+
+	if (rdeps_built)
+		return;
+	rdeps_built = true;
+
+	for_all_symbols(i, sym)
+		sym_walk_deps(sym, sym_count_rdep);
+	for_all_symbols(i, sym) {
+		if (sym->rdeps_count)
+			sym->rdeps = xmalloc(sym->rdeps_count * sizeof(*sym->rdeps));
+		sym->rdeps_count = 0;
+	}
+	for_all_symbols(i, sym)
+		sym_walk_deps(sym, sym_add_rdep);
+}
+
+/*
+ * Clear the valid flag of sym and of every symbol whose value is calculated
+ * from it, directly or indirectly, instead of invalidating all symbols.
+ */
+static void sym_clear_valid_deps(struct symbol *sym)
+{
+	static struct symbol **queue;
+	static int queue_size;
+	struct symbol *cur;
+	int i, head, tail;
+
+	sym_build_rdeps();
+
+	head = tail = 0;
+	cur = sym;
+	cur->flags |= SYMBOL_RDEP_SEEN;
+	for (;;) {
+		if (cur == modules_sym)
+			break;
+		cur->flags &= ~SYMBOL_VALID;
+
+		if (tail + cur->rdeps_count > queue_size) {
+			queue_size = (tail + cur->rdeps_count) * 2;
+			queue = xrealloc(queue, queue_size * sizeof(*queue));
+		}
+		for (i = 0; i < cur->rdeps_count; i++) {
+			struct symbol *dep = cur->rdeps[i];
+
+			if (dep->flags & SYMBOL_RDEP_SEEN)
+				continue;
+			dep->flags |= SYMBOL_RDEP_SEEN;
+			queue[tail++] = dep;
+		}
+
+		if (head == tail)
+			break;
+		cur = queue[head++];
+	}
+
+	sym->flags &= ~SYMBOL_RDEP_SEEN;
+	for (i = 0; i < tail; i++)
+		queue[i]->flags &= ~SYMBOL_RDEP_SEEN;
+
+	/* the tristate type of every symbol depends on modules_sym */
+	if (cur == modules_sym)
+		sym_clear_all_valid();
+	else
+		conf_set_changed(true);
+}
+
 bool sym_tristate_within_range(struct symbol *sym, tristate val)
 {
 	int type = sym_get_type(sym);
@@ -506,7 +649,7 @@ bool sym_set_tristate_value(struct symbol *sym, tristate val)
 
 	sym->def[S_DEF_USER].tri = val;
 	if (oldval != val)
-		sym_clear_all_valid();
+		sym_clear_valid_deps(sym);
 
 	return true;
 }
@@ -663,7 +806,7 @@ bool sym_set_string_value(struct symbol *sym, const char *newval)
 
 	strcpy(val, newval);
 	free((void *)oldval);
-	sym_clear_all_valid();
+	sym_clear_valid_deps(sym);
 
 	return true;
 }
@@ -36,8 +36,26 @@ def get_titles():
     return titles
 
 
+def get_hash():
+    # reuse the hash computed while the image was copied to the bin dir
+    hash_path = json_path.with_suffix(".sha256")
+    if (
+        hash_path.is_file()
+        and hash_path.stat().st_mtime >= file_path.stat().st_mtime
+    ):
+        hash_file = hash_path.read_text().strip()
+        if len(hash_file) == 64:
+            return hash_file
+
+    hash_file = hashlib.sha256()
+    with file_path.open("rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            hash_file.update(chunk)
+    return hash_file.hexdigest()
+
+
 device_id = getenv("DEVICE_ID")
-hash_file = hashlib.sha256(file_path.read_bytes()).hexdigest()
+hash_file = get_hash()
 
 if file_path.with_suffix(file_path.suffix + ".sha256sum").exists():
     hash_unsigned = (
@@ -1,70 +1,140 @@
 #!/usr/bin/env python3
 
-from os import getenv, environ
+from argparse import ArgumentParser
+from concurrent.futures import ProcessPoolExecutor
+from os import getenv, environ, cpu_count
 from pathlib import Path
 from subprocess import run, PIPE
-from sys import argv
 import json
 
-if len(argv) != 2:
-    print("JSON info files script requires output file as argument")
-    exit(1)
+# below this many files per worker, forking is slower than parsing
+CHUNK_MIN = 32
 
-output_path = Path(argv[1])
 
-assert getenv("WORK_DIR"), "$WORK_DIR required"
+def merge_info(output, image_info):
+    if not output:
+        output.update(image_info)
+        return
 
-work_dir = Path(getenv("WORK_DIR"))
+    for device_id, profile in image_info["profiles"].items():
+        if device_id not in output["profiles"]:
+            output["profiles"][device_id] = profile
+        else:
+            output["profiles"][device_id]["images"].extend(profile["images"])
 
-output = {}
 
+def load_chunk(json_files):
+    output = {}
+    for json_file in json_files:
+        merge_info(output, json.loads(json_file.read_bytes()))
+    return output
 
-def get_initial_output(image_info):
-    # preserve existing profiles.json
-    if output_path.is_file():
-        profiles = json.loads(output_path.read_text())
-        if profiles["version_code"] == image_info["version_code"]:
-            return profiles
-    return image_info
 
+def load(json_files):
+    workers = min(cpu_count() or 1, len(json_files) // CHUNK_MIN)
+    if workers < 2:
+        yield load_chunk(json_files)
+        return
 
-for json_file in work_dir.glob("*.json"):
-    image_info = json.loads(json_file.read_text())
+    # chunks are merged in file order, so the last image of a name still wins
+    size = -(-len(json_files) // workers)
+    chunks = [json_files[i : i + size] for i in range(0, len(json_files), size)]
+    with ProcessPoolExecutor(workers) as executor:
+        yield from executor.map(load_chunk, chunks)
 
-    if not output:
-        output = get_initial_output(image_info)
 
-    # get first and only profile in json file
-    device_id, profile = next(iter(image_info["profiles"].items()))
-    if device_id not in output["profiles"]:
-        output["profiles"][device_id] = profile
+def get_existing_output(output_path):
+    # preserve existing profiles.json
+    if not output_path.is_file():
+        return None, 0
+    try:
+        return json.loads(output_path.read_text()), output_path.stat().st_mtime_ns
+    except ValueError:
+        return None, 0
+
+
+def write_ndjson(path, output):
+    header = {k: v for k, v in output.items() if k != "profiles"}
+    with open(path, "w") as f:
+        f.write(json.dumps(header, sort_keys=True, separators=(",", ":")) + "\n")
+        for device_id, profile in sorted(output["profiles"].items()):
+            f.write(
+                json.dumps(
+                    dict(profile, id=device_id), sort_keys=True, separators=(",", ":")
+                )
+                + "\n"
+            )
+
+
+def main():
+    parser = ArgumentParser(description="Merge JSON image info files into one overview")
+    parser.add_argument("output", help="overview file to write, e.g. profiles.json")
+    parser.add_argument(
+        "--ndjson",
+        metavar="FILE",
+        help="also write a newline delimited JSON index: a line with the target "
+        "information followed by one line per profile",
+    )
+    args = parser.parse_args()
+
+    output_path = Path(args.output)
+
+    assert getenv("WORK_DIR"), "$WORK_DIR required"
+
+    work_dir = Path(getenv("WORK_DIR"))
+
+    json_files = sorted(work_dir.glob("*.json"))
+    existing, existing_mtime = get_existing_output(output_path)
+    output = {}
+
+    # files older than an existing profiles.json have been merged into it before,
+    # only load the new ones unless the version changed
+    if existing:
+        new_files = [f for f in json_files if f.stat().st_mtime_ns >= existing_mtime]
+        partials = list(load(new_files)) if new_files else []
+        if all(p.get("version_code") == existing["version_code"] for p in partials):
+            output = existing
+        else:
+            partials = load(json_files)
     else:
-        output["profiles"][device_id]["images"].extend(profile["images"])
-
-# make image lists unique by name, keep last/latest
-for device_id, profile in output.get("profiles", {}).items():
-    profile["images"] = list({e["name"]: e for e in profile["images"]}.values())
-
-
-if output:
-    default_packages, output["arch_packages"] = run(
-        [
-            "make",
-            "--no-print-directory",
-            "-C",
-            "target/linux/",
-            "val.DEFAULT_PACKAGES",
-            "val.ARCH_PACKAGES",
-        ],
-        stdout=PIPE,
-        stderr=PIPE,
-        check=True,
-        env=environ.copy().update({"TOPDIR": Path().cwd()}),
-        universal_newlines=True,
-    ).stdout.splitlines()
-
-    output["default_packages"] = sorted(default_packages.split())
-
-    output_path.write_text(json.dumps(output, sort_keys=True, separators=(",", ":")))
-else:
-    print("JSON info file script could not find any JSON files for target")
+        partials = load(json_files)
+
+    for partial in partials:
+        if partial:
+            merge_info(output, partial)
+
+    # make image lists unique by name, keep last/latest
+    for device_id, profile in output.get("profiles", {}).items():
+        profile["images"] = list({e["name"]: e for e in profile["images"]}.values())
+
+    if output:
+        default_packages, output["arch_packages"] = run(
+            [
+                "make",
+                "--no-print-directory",
+                "-C",
+                "target/linux/",
+                "val.DEFAULT_PACKAGES",
+                "val.ARCH_PACKAGES",
+            ],
+            stdout=PIPE,
+            stderr=PIPE,
+            check=True,
+            env=environ.copy().update({"TOPDIR": Path().cwd()}),
+            universal_newlines=True,
+        ).stdout.splitlines()
+
+        output["default_packages"] = sorted(default_packages.split())
+
+        output_path.write_text(
+            json.dumps(output, sort_keys=True, separators=(",", ":"))
+        )
+
+        if args.ndjson:
+            write_ndjson(args.ndjson, output)
+    else:
+        print("JSON info file script could not find any JSON files for target")
+
+
+if __name__ == "__main__":
+    main()
@@ -545,6 +545,54 @@ sub gen_package_auxiliary() {
 			}
 		}
 	}
+	foreach my $name (sort {uc($a) cmp uc($b)} keys %srcpackage) {
+		my $src = $srcpackage{$name};
+		my %cachedeps;
+		my @packages = map { $_->{name} } @{$src->{packages}};
+		next unless @packages > 0;
+		foreach my $pkg (@{$src->{packages}}) {
+			foreach my $dep (@{$pkg->{depends} || []}) {
+				if ($dep =~ m!^\+?(?:[^:]+:)?([^@]+)$!) {
+					$cachedeps{$1}++;
+				}
+			}
+		}
+		foreach my $bdep (@{$src->{builddepends}}) {
+			(my $dep = $bdep) =~ s/^.+://;
+			next if $dep =~ /\//;
+			my $src_dep = $srcpackage{$dep} or next;
+			$cachedeps{$_->{name}}++ foreach @{$src_dep->{packages}};
+		}
+		delete $cachedeps{$_} foreach @packages;
+		print "Source/$name/packages = @packages\n";
+		print "Source/$name/cachedeps = ".join(" ", sort keys %cachedeps)."\n";
+		print "Source/$name/cachehostdirs = ".join(" ", cache_host_dirs($src))."\n";
+	}
+}
+
+# Host builds do not leave a cache key behind, so the source directories
+# of all host build dependencies, followed recursively, go into the key of
+# the packages using them instead.
+sub cache_host_dirs($) {
+	my $src = shift;
+	my (%dirs, %seen);
+	my @queue = map { [$src, $_] } '', map { "/$_" } @{$src->{buildtypes}};
+
+	while (my $item = shift @queue) {
+		my ($cur, $suffix) = @$item;
+		foreach my $bdep (@{$cur->{"builddepends$suffix"} || []}) {
+			(my $dep = $bdep) =~ s/^.+://;
+			my ($dep_name, $dep_type) = $dep =~ /^(.+)\/(.+)$/ or next;
+			my $src_dep = $srcpackage{$dep_name} or next;
+			next if $seen{$dep}++;
+			(my $dir = $src_dep->{makefile}) =~ s!/Makefile$!!;
+			$dirs{$dir}++;
+			push @queue, [$src_dep, "/$dep_type"];
+		}
+	}
+	(my $own = $src->{makefile}) =~ s!/Makefile$!!;
+	delete $dirs{$own};
+	return sort keys %dirs;
 }
 
 sub gen_package_license($) {